@@ -0,0 +1,437 @@
+#include "BarnesHut.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Bits per axis of the Morton key, i.e. the deepest tree level.
+const int keyLevels = 21;
+// The top levels are built serially; each depth-3 cell is one parallel subtree.
+const int topLevels = 3;
+const std::size_t buckets = std::size_t(1) << (3 * topLevels);
+const int bucketShift = 3 * (keyLevels - topLevels);
+const std::uint64_t absorbedKey = ~std::uint64_t(0);
+const std::uint32_t leafSize = 8;
+// Points per tree walk; see accumulate().
+const std::uint32_t groupSize = 32;
+// Rebuild once refitting has grown the summed leaf size by this factor.
+const double refitGrowth = 1.25;
+
+// Spreads the low 21 bits of v to every third bit.
+std::uint64_t spreadBits(std::uint64_t v) {
+    v &= 0x1FFFFF;
+    v = (v | (v << 32)) & 0x1F00000000FFFFull;
+    v = (v | (v << 16)) & 0x1F0000FF0000FFull;
+    v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+    v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+std::uint64_t keyCell(double x, double lower, double scale) {
+    const double c = std::floor((x - lower) * scale);
+    return static_cast<std::uint64_t>(std::min(std::max(c, 0.0), double((1 << keyLevels) - 1)));
+}
+
+}
+
+const char* BarnesHut::kindName(PairForce kind) {
+    switch (kind) {
+        case PairForce::None: return "none";
+        case PairForce::Gravity: return "gravity";
+        case PairForce::Coulomb: return "coulomb";
+    }
+    return "none";
+}
+
+bool BarnesHut::parseKind(const std::string& name, PairForce& kind) {
+    for (PairForce candidate : {PairForce::None, PairForce::Gravity, PairForce::Coulomb}) {
+        if (name == kindName(candidate)) {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+BarnesHut::BarnesHut(const PairForceParams& params)
+    : params(params), bucketStart(buckets + 2), subtrees(buckets) {}
+
+void BarnesHut::update(const ParticleStore& points, ThreadPool& pool, const AccelerationField& base) {
+    const std::size_t n = points.size();
+    bool rebuild = !built || index.size() != n;
+    if (!rebuild) {
+        gather(points, pool);
+        rebuild = refit(pool) > refitGrowth * builtLeafExtent;
+        refits += rebuild ? 0 : 1;
+    }
+    if (rebuild) {
+        build(points, pool);
+        builtLeafExtent = refit(pool);
+        built = true;
+        ++builds;
+    }
+
+    ax.resize(n);
+    ay.resize(n);
+    az.resize(n);
+    for (std::size_t k = valid; k < n; ++k) {
+        const std::uint32_t i = index[k];
+        ax[i] = base.x[i];
+        ay[i] = base.y[i];
+        az[i] = base.z[i];
+    }
+    pool.parallelFor(groups.size(), 4, [&](std::size_t begin, std::size_t end) {
+        InteractionList list;
+        for (std::size_t g = begin; g < end; ++g) {
+            accumulate(base, groups[g], list);
+        }
+    });
+}
+
+void BarnesHut::build(const ParticleStore& points, ThreadPool& pool) {
+    const std::size_t n = points.size();
+    const std::size_t grain = std::max(ThreadPool::cacheGrain(3 * sizeof(double) + sizeof(std::uint64_t)), (n + 255) / 256);
+    const std::size_t chunks = (n + grain - 1) / grain;
+
+    // Bounding cube of the valid points, reduced per chunk.
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<Bounds> partial(chunks, Bounds{inf, inf, inf, -inf, -inf, -inf});
+    pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+        Bounds& box = partial[begin / grain];
+        for (std::size_t i = begin; i < end; ++i) {
+            const double x = points.px[i], y = points.py[i], z = points.pz[i];
+            if (std::isnan(x) || std::isnan(y) || std::isnan(z)) {
+                continue;
+            }
+            box.lowerX = std::min(box.lowerX, x); box.upperX = std::max(box.upperX, x);
+            box.lowerY = std::min(box.lowerY, y); box.upperY = std::max(box.upperY, y);
+            box.lowerZ = std::min(box.lowerZ, z); box.upperZ = std::max(box.upperZ, z);
+        }
+    });
+    Bounds box{inf, inf, inf, -inf, -inf, -inf};
+    for (const Bounds& b : partial) {
+        box.lowerX = std::min(box.lowerX, b.lowerX); box.upperX = std::max(box.upperX, b.upperX);
+        box.lowerY = std::min(box.lowerY, b.lowerY); box.upperY = std::max(box.upperY, b.upperY);
+        box.lowerZ = std::min(box.lowerZ, b.lowerZ); box.upperZ = std::max(box.upperZ, b.upperZ);
+    }
+    double extent = std::max({box.upperX - box.lowerX, box.upperY - box.lowerY, box.upperZ - box.lowerZ});
+    if (!(extent > 0.0)) {
+        extent = 1.0;
+    }
+    const double scale = double(1 << keyLevels) / extent;
+
+    // Keys and a histogram of the depth-3 cells per chunk; the trailing
+    // bucket holds the absorbed points.
+    pointKeys.resize(n);
+    histogram.assign(chunks * (buckets + 1), 0);
+    pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+        std::uint32_t* counts = histogram.data() + begin / grain * (buckets + 1);
+        for (std::size_t i = begin; i < end; ++i) {
+            const double x = points.px[i], y = points.py[i], z = points.pz[i];
+            std::uint64_t key = absorbedKey;
+            if (!std::isnan(x) && !std::isnan(y) && !std::isnan(z)) {
+                key = spreadBits(keyCell(x, box.lowerX, scale)) | (spreadBits(keyCell(y, box.lowerY, scale)) << 1) |
+                      (spreadBits(keyCell(z, box.lowerZ, scale)) << 2);
+            }
+            pointKeys[i] = key;
+            ++counts[std::min<std::size_t>(key >> bucketShift, buckets)];
+        }
+    });
+
+    // Bucket-major offsets, so each chunk scatters into its own slots and the
+    // partition is stable.
+    std::uint32_t offset = 0;
+    for (std::size_t b = 0; b <= buckets; ++b) {
+        bucketStart[b] = offset;
+        for (std::size_t c = 0; c < chunks; ++c) {
+            const std::uint32_t count = histogram[c * (buckets + 1) + b];
+            histogram[c * (buckets + 1) + b] = offset;
+            offset += count;
+        }
+    }
+    bucketStart[buckets + 1] = offset;
+    valid = bucketStart[buckets];
+
+    entries.resize(n);
+    pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+        std::uint32_t* cursor = histogram.data() + begin / grain * (buckets + 1);
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::uint64_t key = pointKeys[i];
+            entries[cursor[std::min<std::size_t>(key >> bucketShift, buckets)]++] = {key, static_cast<std::uint32_t>(i)};
+        }
+    });
+
+    // Sort and build the subtree of every depth-3 cell.
+    pool.parallelFor(buckets, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) {
+            std::sort(entries.begin() + bucketStart[b], entries.begin() + bucketStart[b + 1],
+                      [](const Entry& l, const Entry& r) { return l.key < r.key || (l.key == r.key && l.index < r.index); });
+            subtrees[b].clear();
+            if (bucketStart[b + 1] > bucketStart[b]) {
+                buildSubtree(subtrees[b], bucketStart[b], bucketStart[b + 1], topLevels);
+            }
+        }
+    });
+
+    index.resize(n);
+    pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            index[k] = entries[k].index;
+        }
+    });
+
+    nodes.clear();
+    topNodes.clear();
+    placedBucket.clear();
+    placedAt.clear();
+    if (valid > 0) {
+        placeTop(0, valid, 0);
+    }
+    bounds.resize(nodes.size());
+    pool.parallelFor(placedAt.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            const std::vector<Node>& subtree = subtrees[placedBucket[p]];
+            const std::uint32_t at = placedAt[p];
+            for (std::size_t k = 0; k < subtree.size(); ++k) {
+                nodes[at + k] = subtree[k];
+                nodes[at + k].next += at;
+            }
+        }
+    });
+
+    groups.clear();
+    for (std::uint32_t i = 0; i < nodes.size();) {
+        if (nodes[i].end - nodes[i].begin <= groupSize || nodes[i].next == i + 1) {
+            groups.push_back(i);
+            i = nodes[i].next;
+        } else {
+            ++i;
+        }
+    }
+    gather(points, pool);
+}
+
+void BarnesHut::buildSubtree(std::vector<Node>& out, std::uint32_t begin, std::uint32_t end, int level) const {
+    const std::uint32_t self = static_cast<std::uint32_t>(out.size());
+    out.push_back(Node{0.0, 0.0, 0.0, 0.0, 0.0, begin, end, 0});
+    if (end - begin > leafSize && level < keyLevels) {
+        // Keys share the bits above this level, so the child octants come in
+        // ascending runs.
+        const int shift = 3 * (keyLevels - level - 1);
+        std::uint32_t childBegin = begin;
+        while (childBegin < end) {
+            const std::uint64_t octant = entries[childBegin].key >> shift & 7;
+            const std::uint32_t childEnd = static_cast<std::uint32_t>(
+                std::partition_point(entries.begin() + childBegin, entries.begin() + end,
+                                     [&](const Entry& e) { return (e.key >> shift & 7) == octant; }) -
+                entries.begin());
+            buildSubtree(out, childBegin, childEnd, level + 1);
+            childBegin = childEnd;
+        }
+    }
+    out[self].next = static_cast<std::uint32_t>(out.size());
+}
+
+void BarnesHut::placeTop(std::uint32_t begin, std::uint32_t end, int level) {
+    const std::uint32_t self = static_cast<std::uint32_t>(nodes.size());
+    nodes.push_back(Node{0.0, 0.0, 0.0, 0.0, 0.0, begin, end, 0});
+    topNodes.push_back(self);
+    if (end - begin > leafSize) {
+        const int shift = 3 * (keyLevels - level - 1);
+        std::uint32_t childBegin = begin;
+        while (childBegin < end) {
+            const std::uint64_t octant = entries[childBegin].key >> shift & 7;
+            const std::uint32_t childEnd = static_cast<std::uint32_t>(
+                std::partition_point(entries.begin() + childBegin, entries.begin() + end,
+                                     [&](const Entry& e) { return (e.key >> shift & 7) == octant; }) -
+                entries.begin());
+            if (level + 1 < topLevels) {
+                placeTop(childBegin, childEnd, level + 1);
+            } else {
+                const std::uint32_t bucket = static_cast<std::uint32_t>(entries[childBegin].key >> bucketShift);
+                placedBucket.push_back(bucket);
+                placedAt.push_back(static_cast<std::uint32_t>(nodes.size()));
+                nodes.resize(nodes.size() + subtrees[bucket].size());
+            }
+            childBegin = childEnd;
+        }
+    }
+    nodes[self].next = static_cast<std::uint32_t>(nodes.size());
+}
+
+void BarnesHut::gather(const ParticleStore& points, ThreadPool& pool) {
+    const std::size_t n = points.size();
+    px.resize(n);
+    py.resize(n);
+    pz.resize(n);
+    weight.resize(n);
+    pool.parallelFor(n, ThreadPool::cacheGrain(8 * sizeof(double)), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            const std::uint32_t i = index[k];
+            const double x = points.px[i], y = points.py[i], z = points.pz[i];
+            const bool absorbed = std::isnan(x) || std::isnan(y) || std::isnan(z);
+            px[k] = absorbed ? 0.0 : x;
+            py[k] = absorbed ? 0.0 : y;
+            pz[k] = absorbed ? 0.0 : z;
+            weight[k] = absorbed ? 0.0 : 1.0;
+        }
+    });
+}
+
+double BarnesHut::refit(ThreadPool& pool) {
+    // Children follow their parent, so a backward pass sees them first.
+    placedExtent.assign(placedAt.size(), 0.0);
+    pool.parallelFor(placedAt.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            const std::uint32_t first = placedAt[p];
+            for (std::uint32_t i = nodes[first].next; i-- > first;) {
+                placedExtent[p] += refitNode(i);
+            }
+        }
+    });
+    double extent = 0.0;
+    for (double e : placedExtent) {
+        extent += e;
+    }
+    for (std::size_t t = topNodes.size(); t-- > 0;) {
+        extent += refitNode(topNodes[t]);
+    }
+    return extent;
+}
+
+double BarnesHut::refitNode(std::uint32_t i) {
+    Node& node = nodes[i];
+    Bounds& box = bounds[i];
+    const double inf = std::numeric_limits<double>::infinity();
+    box = Bounds{inf, inf, inf, -inf, -inf, -inf};
+    double mass = 0.0, sx = 0.0, sy = 0.0, sz = 0.0;
+    const bool leaf = node.next == i + 1;
+    if (leaf) {
+        for (std::uint32_t k = node.begin; k < node.end; ++k) {
+            if (weight[k] == 0.0) {
+                continue;
+            }
+            mass += 1.0;
+            sx += px[k]; sy += py[k]; sz += pz[k];
+            box.lowerX = std::min(box.lowerX, px[k]); box.upperX = std::max(box.upperX, px[k]);
+            box.lowerY = std::min(box.lowerY, py[k]); box.upperY = std::max(box.upperY, py[k]);
+            box.lowerZ = std::min(box.lowerZ, pz[k]); box.upperZ = std::max(box.upperZ, pz[k]);
+        }
+    } else {
+        for (std::uint32_t c = i + 1; c < node.next; c = nodes[c].next) {
+            const Node& child = nodes[c];
+            const Bounds& b = bounds[c];
+            mass += child.mass;
+            sx += child.mass * child.x; sy += child.mass * child.y; sz += child.mass * child.z;
+            box.lowerX = std::min(box.lowerX, b.lowerX); box.upperX = std::max(box.upperX, b.upperX);
+            box.lowerY = std::min(box.lowerY, b.lowerY); box.upperY = std::max(box.upperY, b.upperY);
+            box.lowerZ = std::min(box.lowerZ, b.lowerZ); box.upperZ = std::max(box.upperZ, b.upperZ);
+        }
+    }
+
+    node.mass = mass;
+    if (mass == 0.0) {
+        // Only absorbed points: a massless node that is never opened.
+        node.x = node.y = node.z = 0.0;
+        node.openRadiusSquared = -1.0;
+        return 0.0;
+    }
+    node.x = sx / mass;
+    node.y = sy / mass;
+    node.z = sz / mass;
+    const double dx = std::max(node.x - box.lowerX, box.upperX - node.x);
+    const double dy = std::max(node.y - box.lowerY, box.upperY - node.y);
+    const double dz = std::max(node.z - box.lowerZ, box.upperZ - node.z);
+    const double bmaxSquared = dx * dx + dy * dy + dz * dz;
+    node.openRadiusSquared = params.openingAngle > 0.0 ? bmaxSquared / (params.openingAngle * params.openingAngle) : inf;
+    return leaf ? std::sqrt(bmaxSquared) : 0.0;
+}
+
+void BarnesHut::accumulate(const AccelerationField& base, std::uint32_t group, InteractionList& list) {
+    const Node& target = nodes[group];
+    if (target.mass == 0.0) {
+        for (std::uint32_t k = target.begin; k < target.end; ++k) {
+            const std::uint32_t i = index[k];
+            ax[i] = base.x[i];
+            ay[i] = base.y[i];
+            az[i] = base.z[i];
+        }
+        return;
+    }
+
+    // One walk for the whole group: a node is used as a point mass only if
+    // it is far enough from every point in the group's bounding box.
+    const Bounds& box = bounds[group];
+    list.x.clear();
+    list.y.clear();
+    list.z.clear();
+    list.mass.clear();
+    const std::uint32_t nodeCount = static_cast<std::uint32_t>(nodes.size());
+    std::uint32_t n = 0;
+    while (n < nodeCount) {
+        const Node& node = nodes[n];
+        const double dx = std::max({box.lowerX - node.x, node.x - box.upperX, 0.0});
+        const double dy = std::max({box.lowerY - node.y, node.y - box.upperY, 0.0});
+        const double dz = std::max({box.lowerZ - node.z, node.z - box.upperZ, 0.0});
+        if (dx * dx + dy * dy + dz * dz >= node.openRadiusSquared) {
+            if (node.mass > 0.0) {
+                list.x.push_back(node.x);
+                list.y.push_back(node.y);
+                list.z.push_back(node.z);
+                list.mass.push_back(node.mass);
+            }
+            n = node.next;
+        } else if (node.next == n + 1) {
+            for (std::uint32_t j = node.begin; j < node.end; ++j) {
+                list.x.push_back(px[j]);
+                list.y.push_back(py[j]);
+                list.z.push_back(pz[j]);
+                list.mass.push_back(weight[j]);
+            }
+            n = node.next;
+        } else {
+            ++n;
+        }
+    }
+
+    const double sign = params.kind == PairForce::Coulomb ? -1.0 : 1.0;
+    const double strength = sign * params.strength;
+    const double softeningSquared = params.softening * params.softening;
+    const std::size_t count = list.x.size();
+    const double* lx = list.x.data();
+    const double* ly = list.y.data();
+    const double* lz = list.z.data();
+    const double* lm = list.mass.data();
+    // Vectorized across the group's points rather than along the list, so
+    // each point still sums its terms in list order. A point's own entry has
+    // zero offset and adds nothing.
+    for (std::uint32_t first = target.begin; first < target.end; first += groupSize) {
+        const std::uint32_t size = std::min(groupSize, target.end - first);
+        const double* x = px.data() + first;
+        const double* y = py.data() + first;
+        const double* z = pz.data() + first;
+        double fx[groupSize] = {}, fy[groupSize] = {}, fz[groupSize] = {};
+        for (std::size_t m = 0; m < count; ++m) {
+            const double sx = lx[m], sy = ly[m], sz = lz[m], mass = lm[m];
+            for (std::uint32_t k = 0; k < size; ++k) {
+                const double dx = sx - x[k];
+                const double dy = sy - y[k];
+                const double dz = sz - z[k];
+                const double inverse = 1.0 / std::sqrt(dx * dx + dy * dy + dz * dz + softeningSquared);
+                const double w = mass * inverse * inverse * inverse;
+                fx[k] += w * dx;
+                fy[k] += w * dy;
+                fz[k] += w * dz;
+            }
+        }
+        for (std::uint32_t k = 0; k < size; ++k) {
+            const std::uint32_t i = index[first + k];
+            const double scale = weight[first + k] == 0.0 ? 0.0 : strength;
+            ax[i] = base.x[i] + scale * fx[k];
+            ay[i] = base.y[i] + scale * fy[k];
+            az[i] = base.z[i] + scale * fz[k];
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "AlignedVector.h"
+#include "IntegrationKernel.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Gravity attracts, Coulomb (like charges) repels.
+enum class PairForce { None, Gravity, Coulomb };
+
+struct PairForceParams {
+    PairForce kind = PairForce::None;
+    // Acceleration scale; every point has unit mass (or charge).
+    double strength = 1.0;
+    // Plummer softening length, keeps close encounters finite.
+    double softening = 0.1;
+    // Barnes-Hut opening angle; 0 sums every pair exactly.
+    double openingAngle = 0.5;
+};
+
+// Long-range forces between all pairs of points,
+//   a_i = +-strength * sum_j (x_j - x_i) / (|x_j - x_i|^2 + softening^2)^(3/2),
+// evaluated in O(N log N) with a Barnes-Hut octree: a node whose points are
+// far enough away (the distance to its centre of mass is at least
+// bmax / openingAngle, bmax being the distance from the centre of mass to the
+// farthest corner of the node's bounding box) acts as one point mass.
+//
+// The tree is built in parallel: points are sorted by 63-bit Morton key (a
+// parallel partition on the top nine bits, then one sort per bucket), and the
+// subtrees of the 512 depth-3 cells are built concurrently before being
+// copied into one flat node array in depth-first order, where each node
+// stores the index just past its subtree. Between rebuilds the tree is only
+// refit: the same nodes get new bounding boxes and centres of mass. Refitting
+// never changes the forces' accuracy, only how many nodes get opened, so the
+// tree is rebuilt once the leaf boxes have grown by a quarter.
+//
+// Small subtrees (up to 32 points) walk the tree once for all their points,
+// collecting the accepted nodes and leaf points into one interaction list,
+// which each point then sums in list order. The result does not depend on the
+// thread count.
+class BarnesHut {
+public:
+    static const char* kindName(PairForce kind);
+    static bool parseKind(const std::string& name, PairForce& kind);
+
+    explicit BarnesHut(const PairForceParams& params);
+
+    // Writes each point's `base` acceleration plus its pair acceleration into
+    // ax/ay/az. Points with NaN positions (absorbed) neither feel nor exert
+    // pair forces.
+    void update(const ParticleStore& points, ThreadPool& pool, const AccelerationField& base);
+    AccelerationField field() const { return {ax.data(), ay.data(), az.data()}; }
+    // Morton order of the tree, for ParticleStore::permute.
+    const std::vector<std::uint32_t>& order() const { return index; }
+    // The next update() rebuilds the tree; needed whenever the points were
+    // reordered or removed.
+    void invalidate() { built = false; }
+
+    std::size_t buildCount() const { return builds; }
+    std::size_t refitCount() const { return refits; }
+
+private:
+    struct Node {
+        double x, y, z;
+        double mass;
+        // Squared distance from the centre of mass inside which the node is opened.
+        double openRadiusSquared;
+        std::uint32_t begin, end;
+        // Index just past this node's subtree; children start at this + 1.
+        std::uint32_t next;
+    };
+    struct Bounds {
+        double lowerX, lowerY, lowerZ;
+        double upperX, upperY, upperZ;
+    };
+    // Point masses acting on one group of points.
+    struct InteractionList {
+        AlignedVector<double> x, y, z, mass;
+    };
+    struct Entry {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    void build(const ParticleStore& points, ThreadPool& pool);
+    void buildSubtree(std::vector<Node>& out, std::uint32_t begin, std::uint32_t end, int level) const;
+    void placeTop(std::uint32_t begin, std::uint32_t end, int level);
+    void gather(const ParticleStore& points, ThreadPool& pool);
+    double refit(ThreadPool& pool);
+    double refitNode(std::uint32_t i);
+    void accumulate(const AccelerationField& base, std::uint32_t group, InteractionList& list);
+
+    PairForceParams params;
+    bool built = false;
+    std::size_t builds = 0;
+    std::size_t refits = 0;
+    double builtLeafExtent = 0.0;
+
+    // Points sorted by Morton key; those with a valid position come first.
+    std::uint32_t valid = 0;
+    std::vector<std::uint64_t> pointKeys;
+    std::vector<std::uint32_t> histogram;
+    std::vector<Entry> entries;
+    std::vector<std::uint32_t> index;
+    // Positions in sorted order, and a weight that is 0 for points absorbed
+    // since the last build (their position is then stored as 0).
+    AlignedVector<double> px, py, pz, weight;
+
+    std::vector<Node> nodes;
+    std::vector<Bounds> bounds;
+    // Per depth-3 cell: its key range in the sorted points and the scratch
+    // subtree built for it; kept between builds so the storage is reused.
+    std::vector<std::uint32_t> bucketStart;
+    std::vector<std::vector<Node>> subtrees;
+    // Where each subtree landed in `nodes`. The other nodes (topNodes) form
+    // the top three levels and are refit serially.
+    std::vector<std::uint32_t> placedBucket;
+    std::vector<std::uint32_t> placedAt;
+    std::vector<double> placedExtent;
+    std::vector<std::uint32_t> topNodes;
+    // Subtrees of at most groupSize points that share one tree walk.
+    std::vector<std::uint32_t> groups;
+
+    AlignedVector<double> ax, ay, az;
+};
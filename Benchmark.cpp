@@ -0,0 +1,528 @@
+// pointsim_bench: timings for the integration and output hot paths.
+//
+// Every case is run for each combination of the sweep lists that applies to
+// it and reports the best of --repeat runs. Results are written as JSON so
+// two builds can be compared with a script.
+#include "Simulator.h"
+#include "ParticleStore.h"
+#include "IntegrationKernel.h"
+#include "ThreadPool.h"
+#include "Point.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <sys/resource.h>
+
+#ifdef POINTSIM_HAVE_VTK
+#include "VTKWriter.h"
+#endif
+
+namespace {
+
+const double dt = 0.01;
+const int stepsPerSecond = 100;
+
+// Small problems are repeated until at least this much work is done per
+// timing so that clock resolution does not dominate.
+const double minPointSteps = 2e7;
+
+struct BenchOptions {
+    std::vector<std::size_t> points{1000, 10000, 100000, 1000000};
+    std::vector<int> forces{1, 8};
+    std::vector<unsigned> threads{1, 0};
+    std::vector<std::string> cases{"point_update", "kernel", "kernel_float", "init", "simulate", "print", "vtk"};
+    int repeat = 3;
+    int seconds = 2;
+    std::string kernel = "auto";
+    IntegrationScheme scheme = IntegrationScheme::SemiImplicit;
+    std::string output;
+    std::string scratch = "/tmp";
+};
+
+struct BenchResult {
+    std::string name;
+    std::size_t points = 0;
+    int forces = 0;
+    unsigned threads = 1;
+    double pointSteps = 0.0;
+    double seconds = 0.0;
+    double medianSeconds = 0.0;
+    double bytes = 0.0;
+    // Construction of the Simulator (thread pool, forces, points) until
+    // the first step can run.
+    double timeToFirstStep = 0.0;
+    long peakRssKb = 0;
+};
+
+// Discards everything written to it but keeps count, so text output can be
+// measured without a terminal or a file system in the way.
+class CountingBuffer : public std::streambuf {
+public:
+    std::size_t bytes = 0;
+
+protected:
+    int overflow(int c) override {
+        ++bytes;
+        return c == EOF ? 0 : c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        bytes += static_cast<std::size_t>(n);
+        return n;
+    }
+};
+
+class StreamRedirect {
+public:
+    StreamRedirect(std::ostream& stream, std::streambuf* buffer) : stream(stream), saved(stream.rdbuf(buffer)) {}
+    ~StreamRedirect() { stream.rdbuf(saved); }
+
+private:
+    std::ostream& stream;
+    std::streambuf* saved;
+};
+
+long peakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+SimulationParams benchParams(std::size_t n, int forces, unsigned threads, const std::string& kernel) {
+    SimulationParams params;
+    params.cubeSize = 10.0;
+    params.numPoints = static_cast<int>(n);
+    params.minFriction = 0.1;
+    params.maxFriction = 0.5;
+    params.numForces = forces;
+    params.minAcceleration = -2.0;
+    params.maxAcceleration = 2.0;
+    params.minVelocity = -1.0;
+    params.maxVelocity = 1.0;
+    params.minInitialVelocity = -0.5;
+    params.maxInitialVelocity = 0.5;
+    params.simulationTime = 0;
+    params.enableVTKOutput = false;
+    params.kernel = kernel;
+    params.threads = static_cast<int>(threads);
+    params.quiet = true;
+    return params;
+}
+
+// Same distributions as Simulator::initializePoints, but with a fixed seed
+// and without the Simulator around it.
+template <typename Scalar = double>
+BasicParticleStore<Scalar> makeStore(std::size_t n) {
+    const SimulationParams params = benchParams(n, 1, 1, "auto");
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> position(-params.cubeSize / 2.0, params.cubeSize / 2.0);
+    std::uniform_real_distribution<double> velocity(params.minInitialVelocity, params.maxInitialVelocity);
+    std::uniform_real_distribution<double> acceleration(params.minAcceleration, params.maxAcceleration);
+    std::uniform_real_distribution<double> friction(params.minFriction, params.maxFriction);
+
+    BasicParticleStore<Scalar> store;
+    store.reserve(n);
+    store.limits = {params.minVelocity, params.maxVelocity, params.minAcceleration, params.maxAcceleration};
+    for (std::size_t i = 0; i < n; ++i) {
+        Point point(Vector3D(position(rng), position(rng), position(rng)),
+                    Vector3D(velocity(rng), velocity(rng), velocity(rng)),
+                    Vector3D(0.0, 0.0, 0.0), friction(rng));
+        point.setVelocityLimits(params.minVelocity, params.maxVelocity);
+        point.setAccelerationLimits(params.minAcceleration, params.maxAcceleration);
+        point.applyForce(Vector3D(acceleration(rng), acceleration(rng), acceleration(rng)));
+        store.push_back(point);
+    }
+    return store;
+}
+
+// Number of simulated seconds that gives at least minPointSteps of work.
+int secondsFor(std::size_t n, int minimum) {
+    const double needed = std::ceil(minPointSteps / (static_cast<double>(n) * stepsPerSecond));
+    return std::max(minimum, static_cast<int>(needed));
+}
+
+// Runs body `repeat` times; body returns the number of bytes it wrote.
+void timeCase(BenchResult& result, int repeat, const std::function<double()>& body) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> timings;
+    for (int r = 0; r < repeat; ++r) {
+        const auto start = Clock::now();
+        result.bytes = body();
+        timings.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::sort(timings.begin(), timings.end());
+    result.seconds = timings.front();
+    result.medianSeconds = timings[timings.size() / 2];
+    result.peakRssKb = peakRssKb();
+}
+
+BenchResult benchPointUpdate(std::size_t n, unsigned threads, int repeat) {
+    BenchResult result{"point_update", n, 0, threads};
+    const ParticleStore store = makeStore(n);
+    std::vector<Point> points(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        points[i] = store.get(i);
+    }
+
+    ThreadPool pool(threads);
+    result.threads = pool.size();
+    const int steps = secondsFor(n, 1) * stepsPerSecond;
+    const std::size_t grain = ThreadPool::cacheGrain(sizeof(Point));
+    result.pointSteps = static_cast<double>(n) * steps;
+
+    // The original step loop: every point advances one step before any
+    // point advances the next.
+    timeCase(result, repeat, [&] {
+        for (int s = 0; s < steps; ++s) {
+            pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    points[i].update(dt);
+                }
+            });
+        }
+        return 0.0;
+    });
+    return result;
+}
+
+// Exact advances a whole second at once but is still counted as 100 steps per
+// point-second, so ns_per_point_step compares across integrators.
+// kernel_float runs the same points in a float store.
+template <typename Scalar>
+BenchResult benchKernel(std::size_t n, unsigned threads, IntegrationScheme scheme, int repeat) {
+    BenchResult result{std::is_same<Scalar, float>::value ? "kernel_float" : "kernel", n, 0, threads};
+    BasicParticleStore<Scalar> store = makeStore<Scalar>(n);
+
+    ThreadPool pool(threads);
+    result.threads = pool.size();
+    const int seconds = secondsFor(n, 1);
+    const std::size_t grain = ThreadPool::cacheGrain(BasicParticleStore<Scalar>::bytesPerPoint);
+    result.pointSteps = static_cast<double>(n) * seconds * stepsPerSecond;
+
+    timeCase(result, repeat, [&] {
+        for (int t = 0; t < seconds; ++t) {
+            pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+                IntegrationKernel::integrate(store, begin, end, dt, stepsPerSecond, scheme);
+            });
+        }
+        return 0.0;
+    });
+    return result;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+BenchResult benchInit(std::size_t n, int forces, unsigned threads, const BenchOptions& options) {
+    BenchResult result{"init", n, forces, threads};
+    const auto start = std::chrono::steady_clock::now();
+    Simulator simulator(benchParams(n, forces, threads, options.kernel));
+    result.timeToFirstStep = secondsSince(start);
+    result.threads = simulator.threadCount();
+    result.pointSteps = static_cast<double>(n);
+
+    timeCase(result, options.repeat, [&] {
+        simulator.initializePoints();
+        return 0.0;
+    });
+    return result;
+}
+
+BenchResult benchSimulate(std::size_t n, int forces, unsigned threads, const BenchOptions& options) {
+    BenchResult result{"simulate", n, forces, threads};
+    SimulationParams params = benchParams(n, forces, threads, options.kernel);
+    params.integrator = IntegrationKernel::schemeName(options.scheme);
+    // simulate() runs simulationTime + 1 seconds.
+    params.simulationTime = secondsFor(n, options.seconds + 1) - 1;
+    result.pointSteps = static_cast<double>(n) * (params.simulationTime + 1) * stepsPerSecond;
+
+    const auto start = std::chrono::steady_clock::now();
+    Simulator simulator(params);
+    result.timeToFirstStep = secondsSince(start);
+    result.threads = simulator.threadCount();
+
+    CountingBuffer sink;
+    StreamRedirect quietReport(std::cerr, &sink);
+    timeCase(result, options.repeat, [&] {
+        simulator.simulate();
+        return 0.0;
+    });
+    return result;
+}
+
+BenchResult benchPrint(std::size_t n, const BenchOptions& options) {
+    BenchResult result{"print", n, 1, 1};
+    Simulator simulator(benchParams(n, 1, 1, options.kernel));
+    result.pointSteps = static_cast<double>(n);
+
+    CountingBuffer sink;
+    StreamRedirect captured(std::cout, &sink);
+    timeCase(result, options.repeat, [&] {
+        sink.bytes = 0;
+        simulator.printPointPositions(0);
+        return static_cast<double>(sink.bytes);
+    });
+    return result;
+}
+
+#ifdef POINTSIM_HAVE_VTK
+BenchResult benchVtk(std::size_t n, const BenchOptions& options) {
+    BenchResult result{"vtk", n, 0, 1};
+    const ParticleStore store = makeStore(n);
+    const std::string base = options.scratch + "/pointsim_bench";
+    const std::string filename = VTKWriter::frameFilename(base, 0);
+    result.pointSteps = static_cast<double>(n);
+
+    // One writer for all repeats, as in a series.
+    VTKFrameWriter writer;
+    timeCase(result, options.repeat, [&] {
+        return static_cast<double>(writer.write(store, base, 0));
+    });
+    std::remove(filename.c_str());
+    return result;
+}
+#endif
+
+std::string jsonString(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+// Cases that do not step (init, print, vtk) count one step per point.
+void writeJson(std::ostream& stream, const std::vector<BenchResult>& results, IntegrationScheme scheme) {
+    std::ostringstream out;
+    out << std::setprecision(9);
+    out << "{\n";
+    out << "  \"benchmark\": \"pointsim\",\n";
+    out << "  \"schema\": 3,\n";
+#ifdef __VERSION__
+    out << "  \"compiler\": " << jsonString(__VERSION__) << ",\n";
+#endif
+    out << "  \"kernel\": " << jsonString(IntegrationKernel::isaName(IntegrationKernel::activeIsa())) << ",\n";
+    out << "  \"integrator\": " << jsonString(IntegrationKernel::schemeName(scheme)) << ",\n";
+    out << "  \"hardware_threads\": " << ThreadPool::hardwareThreads() << ",\n";
+    out << "  \"results\": [";
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        const double nsPerPointStep = r.pointSteps > 0.0 ? r.seconds * 1e9 / r.pointSteps : 0.0;
+        const double bytesPerSecond = r.seconds > 0.0 ? r.bytes / r.seconds : 0.0;
+        out << (i ? ",\n" : "\n");
+        out << "    {\"case\": " << jsonString(r.name)
+            << ", \"points\": " << r.points
+            << ", \"forces\": " << r.forces
+            << ", \"threads\": " << r.threads
+            << ", \"point_steps\": " << r.pointSteps
+            << ", \"seconds\": " << r.seconds
+            << ", \"median_seconds\": " << r.medianSeconds
+            << ", \"ns_per_point_step\": " << nsPerPointStep
+            << ", \"bytes\": " << r.bytes
+            << ", \"bytes_per_second\": " << bytesPerSecond
+            << ", \"time_to_first_step\": " << r.timeToFirstStep
+            << ", \"peak_rss_kb\": " << r.peakRssKb << "}";
+    }
+    out << "\n  ]\n}\n";
+    stream << out.str();
+}
+
+template <typename T>
+bool parseList(const std::string& text, std::vector<T>& values) {
+    values.clear();
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        char* end = nullptr;
+        // strtod so that sizes can be written as 1e6.
+        const double value = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || value < 0) {
+            return false;
+        }
+        values.push_back(static_cast<T>(value));
+    }
+    return !values.empty();
+}
+
+void printUsage() {
+    std::cout << "Usage: pointsim_bench [options]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --points <list>   - Point counts to sweep (default 1e3,1e4,1e5,1e6)\n";
+    std::cout << "  --forces <list>   - Force counts to sweep (default 1,8)\n";
+    std::cout << "  --threads <list>  - Thread counts to sweep, 0 = all hardware threads (default 1,0)\n";
+    std::cout << "  --cases <list>    - point_update, kernel, kernel_float, init, simulate, print, vtk (default all)\n";
+    std::cout << "  --repeat <r>      - Runs per measurement, the best is reported (default 3)\n";
+    std::cout << "  --seconds <s>     - Minimum simulated seconds for the simulate case (default 2)\n";
+    std::cout << "  --kernel <isa>    - Integration kernel: auto, scalar, sse2, avx2, avx512\n";
+    std::cout << "  --integrator <name> - Scheme for kernel and simulate: euler, semi_implicit (default), verlet, rk4, exact\n";
+    std::cout << "  --scratch <dir>   - Directory for temporary output files (default /tmp)\n";
+    std::cout << "  --output <file>   - Write the JSON report to a file instead of stdout\n";
+}
+
+bool parseOptions(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            std::exit(0);
+        }
+        const char* const known[] = {"--points", "--forces", "--threads", "--cases", "--repeat",
+                                     "--seconds", "--kernel", "--integrator", "--scratch", "--output"};
+        if (std::find(std::begin(known), std::end(known), arg) == std::end(known)) {
+            std::cerr << "Error: Unknown option " << arg << "\n";
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << arg << " requires a value.\n";
+            return false;
+        }
+        const std::string value = argv[++i];
+
+        bool ok = true;
+        if (arg == "--points") {
+            ok = parseList(value, options.points);
+        } else if (arg == "--forces") {
+            ok = parseList(value, options.forces);
+        } else if (arg == "--threads") {
+            ok = parseList(value, options.threads);
+        } else if (arg == "--cases") {
+            options.cases.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                options.cases.push_back(item);
+            }
+        } else if (arg == "--repeat") {
+            options.repeat = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--seconds") {
+            options.seconds = std::max(0, std::atoi(value.c_str()));
+        } else if (arg == "--kernel") {
+            KernelIsa isa;
+            ok = IntegrationKernel::parseIsa(value, isa);
+            if (ok && !IntegrationKernel::selectIsa(isa)) {
+                std::cerr << "Error: " << value << " kernel not supported by this CPU.\n";
+                return false;
+            }
+            options.kernel = value;
+        } else if (arg == "--integrator") {
+            ok = IntegrationKernel::parseScheme(value, options.scheme);
+        } else if (arg == "--scratch") {
+            options.scratch = value;
+        } else if (arg == "--output") {
+            options.output = value;
+        }
+
+        if (!ok) {
+            std::cerr << "Error: Invalid value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+
+    // 0 means all hardware threads; drop sweeps that resolve to the same count.
+    for (unsigned& threads : options.threads) {
+        threads = threads == 0 ? ThreadPool::hardwareThreads() : threads;
+    }
+    std::sort(options.threads.begin(), options.threads.end());
+    options.threads.erase(std::unique(options.threads.begin(), options.threads.end()), options.threads.end());
+
+    for (std::size_t n : options.points) {
+        if (n == 0 || n > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+            std::cerr << "Error: Point counts must be between 1 and " << std::numeric_limits<int>::max() << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool wantsCase(const BenchOptions& options, const std::string& name) {
+    return std::find(options.cases.begin(), options.cases.end(), name) != options.cases.end();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    auto record = [&](const BenchResult& result) {
+        std::cerr << result.name << " points=" << result.points << " forces=" << result.forces
+                  << " threads=" << result.threads << ": " << result.seconds << " s\n";
+        results.push_back(result);
+    };
+
+    try {
+        for (std::size_t n : options.points) {
+            for (unsigned threads : options.threads) {
+                if (wantsCase(options, "point_update")) {
+                    record(benchPointUpdate(n, threads, options.repeat));
+                }
+                if (wantsCase(options, "kernel")) {
+                    record(benchKernel<double>(n, threads, options.scheme, options.repeat));
+                }
+                if (wantsCase(options, "kernel_float")) {
+                    record(benchKernel<float>(n, threads, options.scheme, options.repeat));
+                }
+            }
+            for (int forces : options.forces) {
+                for (unsigned threads : options.threads) {
+                    if (wantsCase(options, "init")) {
+                        record(benchInit(n, forces, threads, options));
+                    }
+                    if (wantsCase(options, "simulate")) {
+                        record(benchSimulate(n, forces, threads, options));
+                    }
+                }
+            }
+            if (wantsCase(options, "print")) {
+                record(benchPrint(n, options));
+            }
+#ifdef POINTSIM_HAVE_VTK
+            if (wantsCase(options, "vtk")) {
+                record(benchVtk(n, options));
+            }
+#endif
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (options.output.empty()) {
+        writeJson(std::cout, results, options.scheme);
+    } else {
+        std::ofstream file(options.output);
+        if (!file) {
+            std::cerr << "Error: Could not open output file: " << options.output << "\n";
+            return 1;
+        }
+        writeJson(file, results, options.scheme);
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "CellList.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int maxDims = 1024;
+
+// Spreads the low 10 bits of v to every third bit.
+std::uint32_t spreadBits(std::uint32_t v) {
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+std::uint32_t mortonCode(std::uint32_t x, std::uint32_t y, std::uint32_t z) {
+    return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+}
+
+// Keys of cellOf() before buckets are numbered.
+const std::uint32_t outsideKey = 0xFFFFFFFEu;
+const std::uint32_t absorbedKey = 0xFFFFFFFFu;
+// Far enough for any simulated position, small enough for the hash.
+const double maxCoordinate = 1099511627776.0;
+
+std::uint64_t mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+}
+
+void CellList::configure(double lower, double upper, double cutoff, bool periodic, std::size_t maxPoints) {
+    this->lower = lower;
+    this->upper = upper;
+    size = upper - lower;
+    wrap = periodic;
+
+    // Cells no narrower than the cutoff, and no more than one per point: with
+    // sparser cells the per-cell neighbour lookup outweighs the saved pairs.
+    const double byCutoff = cutoff > 0.0 ? std::floor(size / cutoff) : 1.0;
+    const double byPoints = std::floor(std::cbrt(static_cast<double>(std::max<std::size_t>(maxPoints, 1))));
+    dims = static_cast<int>(std::max(1.0, std::min({byCutoff, byPoints, static_cast<double>(maxDims)})));
+    inverseCellSize = dims / size;
+    cells = static_cast<std::size_t>(dims) * dims * dims;
+
+    std::vector<std::uint32_t> linear(cells);
+    std::vector<std::uint32_t> codes(cells);
+    for (std::size_t i = 0; i < cells; ++i) {
+        const std::uint32_t x = static_cast<std::uint32_t>(i % dims);
+        const std::uint32_t y = static_cast<std::uint32_t>(i / dims % dims);
+        const std::uint32_t z = static_cast<std::uint32_t>(i / dims / dims);
+        linear[i] = static_cast<std::uint32_t>(i);
+        codes[i] = mortonCode(x, y, z);
+    }
+    std::sort(linear.begin(), linear.end(), [&](std::uint32_t a, std::uint32_t b) { return codes[a] < codes[b]; });
+
+    coordinatesOf = linear;
+    rankOf.resize(cells);
+    for (std::size_t rank = 0; rank < cells; ++rank) {
+        rankOf[linear[rank]] = static_cast<std::uint32_t>(rank);
+    }
+}
+
+std::uint32_t CellList::cellOf(double x, double y, double z) const {
+    if (std::isnan(x) || std::isnan(y) || std::isnan(z)) {
+        return absorbedKey;
+    }
+    const std::int64_t cx = axisCell(x), cy = axisCell(y), cz = axisCell(z);
+    if (cx < 0 || cy < 0 || cz < 0 || cx >= dims || cy >= dims || cz >= dims) {
+        return outsideKey;
+    }
+    return rankOf[cx + dims * (cy + dims * cz)];
+}
+
+std::int64_t CellList::axisCell(double x) const {
+    double c = std::floor((x - lower) * inverseCellSize);
+    if (wrap) {
+        c -= dims * std::floor(c / dims);
+    } else if (x >= lower && x <= upper) {
+        // Rounding at the walls stays in the edge cells.
+        return static_cast<std::int64_t>(std::min(std::max(c, 0.0), static_cast<double>(dims - 1)));
+    }
+    return static_cast<std::int64_t>(std::min(std::max(c, -maxCoordinate), maxCoordinate));
+}
+
+std::uint32_t CellList::bucketOf(std::int64_t x, std::int64_t y, std::int64_t z) const {
+    const std::uint64_t h = mix(static_cast<std::uint64_t>(x) ^ mix(static_cast<std::uint64_t>(y) ^ mix(static_cast<std::uint64_t>(z))));
+    return static_cast<std::uint32_t>(cells + (h & (buckets - 1)));
+}
+
+void CellList::build(const ParticleStore& points, ThreadPool& pool) {
+    const std::size_t n = points.size();
+    const std::size_t grain = ThreadPool::cacheGrain(3 * sizeof(double) + sizeof(std::uint32_t));
+    keys.resize(n);
+    pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            keys[i] = cellOf(points.px[i], points.py[i], points.pz[i]);
+        }
+    });
+
+    // About one bucket per point outside, a power of two for the mask.
+    const std::size_t outside = static_cast<std::size_t>(std::count(keys.begin(), keys.end(), outsideKey));
+    buckets = 0;
+    if (outside > 0) {
+        buckets = 1;
+        while (buckets < outside) {
+            buckets *= 2;
+        }
+    }
+    pool.parallelFor(n, grain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (keys[i] == outsideKey) {
+                keys[i] = bucketOf(axisCell(points.px[i]), axisCell(points.py[i]), axisCell(points.pz[i]));
+            } else if (keys[i] == absorbedKey) {
+                keys[i] = static_cast<std::uint32_t>(cells + buckets);
+            }
+        }
+    });
+
+    // Counting sort; stable, so the order only depends on the positions.
+    const std::size_t total = cells + buckets + 1;
+    cellStart.assign(total + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        ++cellStart[keys[i] + 1];
+    }
+    for (std::size_t c = 0; c + 1 < total; ++c) {
+        cellStart[c + 1] += cellStart[c];
+    }
+
+    index.resize(n);
+    px.resize(n); py.resize(n); pz.resize(n);
+    vx.resize(n); vy.resize(n); vz.resize(n);
+    std::vector<std::uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint32_t k = cursor[keys[i]]++;
+        index[k] = static_cast<std::uint32_t>(i);
+        px[k] = points.px[i];
+        py[k] = points.py[i];
+        pz[k] = points.pz[i];
+        vx[k] = points.vx[i];
+        vy[k] = points.vy[i];
+        vz[k] = points.vz[i];
+    }
+}
+
+std::size_t CellList::neighbours(std::size_t c, Range* out) const {
+    const std::uint32_t linear = coordinatesOf[c];
+    return neighboursAt(linear % dims, linear / dims % dims, linear / dims / dims, out);
+}
+
+std::size_t CellList::neighboursOf(std::uint32_t k, Range* out) const {
+    return neighboursAt(axisCell(px[k]), axisCell(py[k]), axisCell(pz[k]), out);
+}
+
+std::size_t CellList::neighboursAt(std::int64_t x, std::int64_t y, std::int64_t z, Range* out) const {
+    std::uint32_t ranks[27];
+    std::size_t count = 0;
+    for (std::int64_t k = z - 1; k <= z + 1; ++k) {
+        for (std::int64_t j = y - 1; j <= y + 1; ++j) {
+            for (std::int64_t i = x - 1; i <= x + 1; ++i) {
+                if (wrap) {
+                    ranks[count++] = rankOf[(i + dims) % dims + dims * ((j + dims) % dims + dims * ((k + dims) % dims))];
+                } else if (i >= 0 && j >= 0 && k >= 0 && i < dims && j < dims && k < dims) {
+                    ranks[count++] = rankOf[i + dims * (j + dims * k)];
+                } else if (buckets > 0) {
+                    ranks[count++] = bucketOf(i, j, k);
+                }
+            }
+        }
+    }
+
+    // Cells with consecutive Morton ranks are adjacent in memory, so each run
+    // of them becomes one range: fewer, longer loops over the points. Small
+    // periodic grids and shared buckets repeat keys, which are covered once.
+    std::sort(ranks, ranks + count);
+    count = static_cast<std::size_t>(std::unique(ranks, ranks + count) - ranks);
+    std::size_t ranges = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (ranges > 0 && ranks[i] == ranks[i - 1] + 1) {
+            out[ranges - 1].end = cellStart[ranks[i] + 1];
+        } else {
+            out[ranges++] = cell(ranks[i]);
+        }
+    }
+    return ranges;
+}
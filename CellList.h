@@ -0,0 +1,78 @@
+#pragma once
+#include "AlignedVector.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over the cube [lower, upper]^3 with cells at least `cutoff`
+// wide, so every pair closer than the cutoff sits in the same or an adjacent
+// cell. Cells are numbered in Morton (Z-order) order and build() copies the
+// points into that order with a counting sort, so neighbouring cells are
+// mostly neighbours in memory as well. Points outside the cube are wrapped
+// (periodic) or, with open walls, go to cells of the same size continuing
+// the grid, hashed into buckets that follow the cube's cells; points that
+// escape therefore stay spread over as many cells as they occupy. Points
+// with NaN positions (absorbed) go to a trailing bucket that belongs to no
+// cell.
+class CellList {
+public:
+    struct Range {
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+
+    void configure(double lower, double upper, double cutoff, bool periodic, std::size_t maxPoints);
+    void build(const ParticleStore& points, ThreadPool& pool);
+
+    std::size_t cellCount() const { return cells; }
+    // Buckets of the last build() for points outside the cube, numbered
+    // after the cells.
+    std::size_t bucketCount() const { return buckets; }
+    bool periodic() const { return wrap; }
+    double boxSize() const { return size; }
+
+    // Sorted points of the c-th cell in Morton order (or of bucket
+    // c - cellCount()), and of the bucket of absorbed points.
+    Range cell(std::size_t c) const { return {cellStart[c], cellStart[c + 1]}; }
+    Range absorbed() const { return {cellStart[cells + buckets], cellStart[cells + buckets + 1]}; }
+    // Original index of each sorted point, i.e. the Morton order.
+    const std::vector<std::uint32_t>& order() const { return index; }
+
+    // Points of the cells around the c-th cell (c < cellCount()), itself
+    // included, each cell covered once. Returns the number of ranges written
+    // (at most 27).
+    std::size_t neighbours(std::size_t c, Range* out) const;
+    // The same around the cell of sorted point k; needed for points in
+    // buckets, which may hold several cells. Ranges may include points of
+    // other cells that share a bucket.
+    std::size_t neighboursOf(std::uint32_t k, Range* out) const;
+
+    AlignedVector<double> px, py, pz;
+    AlignedVector<double> vx, vy, vz;
+
+private:
+    std::uint32_t cellOf(double x, double y, double z) const;
+    // Cell coordinate along one axis, unbounded for points outside the cube.
+    std::int64_t axisCell(double x) const;
+    std::uint32_t bucketOf(std::int64_t x, std::int64_t y, std::int64_t z) const;
+    std::size_t neighboursAt(std::int64_t x, std::int64_t y, std::int64_t z, Range* out) const;
+
+    double lower = 0.0;
+    double upper = 0.0;
+    double size = 0.0;
+    double inverseCellSize = 0.0;
+    int dims = 1;
+    bool wrap = false;
+    std::size_t cells = 1;
+    std::size_t buckets = 0;
+
+    // Morton rank of grid cell x + dims * (y + dims * z), and back.
+    std::vector<std::uint32_t> rankOf;
+    std::vector<std::uint32_t> coordinatesOf;
+
+    std::vector<std::uint32_t> keys;
+    std::vector<std::uint32_t> cellStart;
+    std::vector<std::uint32_t> index;
+};
@@ -0,0 +1,258 @@
+#include "Checkpoint.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char checkpointMagic[8] = {'P', 'S', 'I', 'M', 'C', 'K', 'P', '\0'};
+const std::uint32_t checkpointVersion = 1;
+const std::size_t componentCount = 10;
+const std::size_t valuesPerForce = 5;
+const std::size_t fileAlignment = 64;
+
+std::uint64_t alignUp(std::uint64_t offset) {
+    return (offset + fileAlignment - 1) / fileAlignment * fileAlignment;
+}
+
+template <typename Scalar>
+const Scalar* sourceComponent(const BasicParticleStore<Scalar>& points, std::size_t c) {
+    const AlignedVector<Scalar>* components[componentCount] = {
+        &points.px, &points.py, &points.pz, &points.vx, &points.vy, &points.vz,
+        &points.ax, &points.ay, &points.az, &points.friction
+    };
+    return components[c]->data();
+}
+
+template <typename Scalar>
+Scalar* targetComponent(BasicParticleStore<Scalar>& points, std::size_t c) {
+    AlignedVector<Scalar>* components[componentCount] = {
+        &points.px, &points.py, &points.pz, &points.vx, &points.vy, &points.vz,
+        &points.ax, &points.ay, &points.az, &points.friction
+    };
+    return components[c]->data();
+}
+
+// The directory holding `path`, for syncing a rename into it.
+std::string parentDirectory(const std::string& path) {
+    const std::size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// Writes data and then zeros up to `end`, tracking the file offset.
+class FileWriter {
+public:
+    FileWriter(int fd, const std::string& path) : fd(fd), path(path) {}
+
+    void append(const void* data, std::size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            const ssize_t written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Failed to write checkpoint file " + path + ": " + std::strerror(errno));
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+            offset += static_cast<std::uint64_t>(written);
+        }
+    }
+
+    void padTo(std::uint64_t end) {
+        static const char zeros[fileAlignment] = {};
+        while (offset < end) {
+            append(zeros, static_cast<std::size_t>(std::min<std::uint64_t>(end - offset, fileAlignment)));
+        }
+    }
+
+    std::uint64_t position() const { return offset; }
+
+private:
+    int fd;
+    const std::string& path;
+    std::uint64_t offset = 0;
+};
+
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& filename, int every, const CheckpointHeader& run,
+                                   const std::vector<Force>& forces)
+    : filename(filename), every(every > 0 ? every : 1), run(run) {
+    forceBlock.reserve(forces.size() * valuesPerForce);
+    for (const Force& force : forces) {
+        forceBlock.insert(forceBlock.end(), {force.direction.x, force.direction.y, force.direction.z,
+                                             force.minMagnitude, force.maxMagnitude});
+    }
+    std::memcpy(this->run.magic, checkpointMagic, sizeof(checkpointMagic));
+    this->run.version = checkpointVersion;
+    this->run.numForces = static_cast<std::uint32_t>(forces.size());
+}
+
+bool CheckpointWriter::wants(int timeStep) const {
+    return timeStep % every == 0;
+}
+
+std::string CheckpointWriter::temporaryFilename(const std::string& filename, int timeStep) {
+    return filename + "." + std::to_string(timeStep) + ".tmp";
+}
+
+// Checkpoints of different frames go to different temporary files, so they
+// can be written concurrently; only the rename is ordered.
+std::size_t CheckpointWriter::process(Frame& frame) {
+    if (frame.precision == Precision::Float) {
+        return write(frame, frame.floatPoints);
+    }
+    return write(frame, frame.points);
+}
+
+std::size_t CheckpointWriter::commit(Frame& frame) {
+    const std::string path = temporaryFilename(filename, frame.timeStep);
+    if (std::rename(path.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("Could not replace checkpoint file " + filename + ": " + std::strerror(errno));
+    }
+    // The rename itself is only durable once the directory entry is on disk.
+    const std::string directory = parentDirectory(filename);
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open checkpoint directory " + directory + ": " + std::strerror(errno));
+    }
+    if (::fsync(fd) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Could not sync checkpoint directory " + directory + ": " + std::strerror(error));
+    }
+    ::close(fd);
+    return 0;
+}
+
+template <typename Scalar>
+std::size_t CheckpointWriter::write(const Frame& frame, const BasicParticleStore<Scalar>& points) {
+    ProfileScope profile(ProfilePhase::Checkpoint, frame.timeStep);
+    const std::uint64_t count = points.size();
+
+    CheckpointHeader header = run;
+    header.scalarBytes = sizeof(Scalar);
+    header.count = count;
+    header.timeStep = frame.timeStep;
+    header.time = frame.time;
+    header.hasIds = points.indexed ? 1u : 0u;
+    header.forcesOffset = alignUp(sizeof(CheckpointHeader));
+    header.dataOffset = alignUp(header.forcesOffset + forceBlock.size() * sizeof(double));
+    header.arrayStride = alignUp(count * sizeof(Scalar));
+
+    const std::string path = temporaryFilename(filename, frame.timeStep);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open checkpoint file " + path + ": " + std::strerror(errno));
+    }
+    try {
+        FileWriter out(fd, path);
+        out.append(&header, sizeof(header));
+        out.padTo(header.forcesOffset);
+        out.append(forceBlock.data(), forceBlock.size() * sizeof(double));
+        for (std::size_t c = 0; c < componentCount; ++c) {
+            out.padTo(header.dataOffset + c * header.arrayStride);
+            out.append(sourceComponent(points, c), count * sizeof(Scalar));
+        }
+        out.padTo(header.dataOffset + componentCount * header.arrayStride);
+        if (header.hasIds) {
+            out.append(points.ids.data(), count * sizeof(std::uint32_t));
+        }
+        // The data must be on disk before the rename makes it the checkpoint.
+        if (::fsync(fd) != 0) {
+            throw std::runtime_error("Could not sync checkpoint file " + path + ": " + std::strerror(errno));
+        }
+        ::close(fd);
+        profile.add(out.position(), count);
+        return out.position();
+    } catch (...) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw;
+    }
+}
+
+CheckpointReader::CheckpointReader(const std::string& filename) : filename(filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open checkpoint file: " + filename);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(CheckpointHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a checkpoint file: " + filename);
+    }
+    size = static_cast<std::size_t>(info.st_size);
+
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map checkpoint file: " + filename);
+    }
+    data = static_cast<const char*>(mapping);
+    fileHeader = reinterpret_cast<const CheckpointHeader*>(data);
+
+    const CheckpointHeader& h = *fileHeader;
+    const std::uint64_t arrays = h.dataOffset + componentCount * h.arrayStride;
+    const std::uint64_t expected = arrays + (h.hasIds ? h.count * sizeof(std::uint32_t) : 0);
+    if (std::memcmp(h.magic, checkpointMagic, sizeof(checkpointMagic)) != 0 || h.version != checkpointVersion ||
+        (h.scalarBytes != sizeof(float) && h.scalarBytes != sizeof(double)) || h.count > h.numPoints ||
+        h.arrayStride < h.count * h.scalarBytes || h.forcesOffset + h.numForces * valuesPerForce * sizeof(double) > h.dataOffset ||
+        expected > size) {
+        ::munmap(mapping, size);
+        throw std::runtime_error("Not a checkpoint file or truncated: " + filename);
+    }
+}
+
+CheckpointReader::~CheckpointReader() {
+    if (data) {
+        ::munmap(const_cast<char*>(data), size);
+    }
+}
+
+std::vector<Force> CheckpointReader::forces() const {
+    const double* values = reinterpret_cast<const double*>(data + fileHeader->forcesOffset);
+    std::vector<Force> forces(fileHeader->numForces);
+    for (Force& force : forces) {
+        // Assigned directly: normalizing again could change the last bit.
+        force.direction = Vector3D(values[0], values[1], values[2]);
+        force.minMagnitude = values[3];
+        force.maxMagnitude = values[4];
+        values += valuesPerForce;
+    }
+    return forces;
+}
+
+template <typename Scalar>
+void CheckpointReader::readPoints(BasicParticleStore<Scalar>& points) const {
+    const CheckpointHeader& h = *fileHeader;
+    if (h.scalarBytes != sizeof(Scalar)) {
+        throw std::runtime_error("Checkpoint precision does not match the run: " + filename);
+    }
+    const std::size_t count = static_cast<std::size_t>(h.count);
+    points.clear();
+    points.indexed = h.hasIds != 0;
+    points.resize(count);
+    for (std::size_t c = 0; c < componentCount; ++c) {
+        std::memcpy(targetComponent(points, c), data + h.dataOffset + c * h.arrayStride, count * sizeof(Scalar));
+    }
+    if (h.hasIds) {
+        std::memcpy(points.ids.data(), data + h.dataOffset + componentCount * h.arrayStride, count * sizeof(std::uint32_t));
+    }
+}
+
+template void CheckpointReader::readPoints(ParticleStore&) const;
+template void CheckpointReader::readPoints(FloatParticleStore&) const;
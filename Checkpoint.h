@@ -0,0 +1,87 @@
+#pragma once
+#include "Force.h"
+#include "OutputPipeline.h"
+#include "ParticleStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary checkpoint layout (host byte order):
+//
+//   CheckpointHeader
+//   forces: numForces x (direction x, y, z, minMagnitude, maxMagnitude) as double
+//   px py pz vx vy vz ax ay az friction: count values each as float or double
+//   ids: count uint32 (only with hasIds)
+//
+// Every array starts on a 64-byte boundary of the file, so a mapped file can
+// be copied straight into the store. The state is the one after output time
+// timeStep; a resumed run continues with timeStep + 1. Draws are keyed by
+// (seed, point, step), so the seed is the whole random state.
+struct CheckpointHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t scalarBytes;
+    std::uint64_t seed;
+    std::uint64_t numPoints;
+    std::uint64_t count;
+    std::int64_t timeStep;
+    double time;
+    std::int32_t stepsPerOutput;
+    std::int32_t resampleSteps;
+    std::int32_t scheme;
+    std::int32_t boundary;
+    std::uint32_t numForces;
+    std::uint32_t hasIds;
+    std::uint64_t forcesOffset;
+    std::uint64_t dataOffset;
+    // Bytes from one array to the next, padding included.
+    std::uint64_t arrayStride;
+};
+
+// Writes the frames at every `every`-th output time as checkpoints. The file
+// is written on a writer thread to <filename>.<timeStep>.tmp, synced, and
+// renamed over <filename> in frame order, so <filename> always holds a
+// complete checkpoint.
+class CheckpointWriter : public FrameSink {
+public:
+    CheckpointWriter(const std::string& filename, int every, const CheckpointHeader& run, const std::vector<Force>& forces);
+
+    const char* name() const override { return "checkpoint"; }
+    bool wants(int timeStep) const override;
+    std::size_t process(Frame& frame) override;
+    std::size_t commit(Frame& frame) override;
+
+    static std::string temporaryFilename(const std::string& filename, int timeStep);
+
+private:
+    template <typename Scalar>
+    std::size_t write(const Frame& frame, const BasicParticleStore<Scalar>& points);
+
+    std::string filename;
+    int every;
+    CheckpointHeader run;
+    std::vector<double> forceBlock;
+};
+
+// Read-only, memory-mapped view of a checkpoint file.
+class CheckpointReader {
+public:
+    explicit CheckpointReader(const std::string& filename);
+    ~CheckpointReader();
+
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+    const CheckpointHeader& header() const { return *fileHeader; }
+    std::vector<Force> forces() const;
+    // Fails unless the file holds Scalar values.
+    template <typename Scalar>
+    void readPoints(BasicParticleStore<Scalar>& points) const;
+
+private:
+    std::string filename;
+    const char* data = nullptr;
+    std::size_t size = 0;
+    const CheckpointHeader* fileHeader = nullptr;
+};
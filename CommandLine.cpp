@@ -0,0 +1,539 @@
+#include "CommandLine.h"
+#include "Simulator.h"
+#include "ConfigParser.h"
+#include "IntegrationKernel.h"
+#include "BarnesHut.h"
+#include "Trajectory.h"
+#include "TextFrameSink.h"
+#include "Sweep.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+
+#ifdef POINTSIM_HAVE_VTK
+#include "VTKWriter.h"
+#endif
+
+namespace {
+
+// Run options given on the command line; they override the config file.
+struct RunOptions {
+    int threads = -1;
+    bool quiet = false;
+    int printStride = 0;
+    int printInterval = 0;
+    std::string outputFormat;
+    bool profile = false;
+    std::string profileOutput;
+    std::uint64_t seed = 0;
+    bool hasSeed = false;
+    std::string integrator;
+    std::string boundary;
+    std::string pairForce;
+    std::string forceMode;
+    std::string precision;
+    double dt = 0.0;
+    double outputInterval = 0.0;
+    double checkpointInterval = 0.0;
+    std::string checkpointFile;
+    bool resume = false;
+};
+
+// Parses an integer option value of at least `minimum`; prints the problem
+// and returns false for anything else, including trailing characters.
+bool parseIntOption(const std::string& option, const std::string& text, int minimum, int& value) {
+    std::size_t used = 0;
+    int parsed = 0;
+    try {
+        parsed = std::stoi(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || parsed < minimum) {
+        std::cerr << "Error: " << option << " expects a whole number of at least " << minimum << ", got '" << text << "'.\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Parses a positive, finite number; prints the problem and returns false for
+// anything else, including trailing characters.
+bool parseDoubleOption(const std::string& option, const std::string& text, double& value) {
+    std::size_t used = 0;
+    double parsed = 0.0;
+    try {
+        parsed = std::stod(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || !std::isfinite(parsed) || parsed <= 0.0) {
+        std::cerr << "Error: " << option << " expects a positive number, got '" << text << "'.\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Applies the command-line options over the config file's values and checks
+// the result; prints the problem and returns false if it is invalid.
+bool applyOptions(const RunOptions& options, SimulationParams& params) {
+    if (options.threads >= 0) {
+        params.threads = options.threads;
+    }
+    if (options.quiet) {
+        params.quiet = true;
+    }
+    if (!options.integrator.empty()) {
+        IntegrationScheme scheme;
+        if (!IntegrationKernel::parseScheme(options.integrator, scheme)) {
+            std::cerr << "Error: Unknown integrator '" << options.integrator << "' (expected euler, semi_implicit, verlet, rk4 or exact).\n";
+            return false;
+        }
+        params.integrator = options.integrator;
+    }
+    if (!options.boundary.empty()) {
+        BoundaryMode mode;
+        if (!IntegrationKernel::parseBoundary(options.boundary, mode)) {
+            std::cerr << "Error: Unknown boundary '" << options.boundary << "' (expected none, reflect, periodic or absorb).\n";
+            return false;
+        }
+        params.boundary = options.boundary;
+    }
+    if (!options.pairForce.empty()) {
+        PairForce kind;
+        if (!BarnesHut::parseKind(options.pairForce, kind)) {
+            std::cerr << "Error: Unknown pair force '" << options.pairForce << "' (expected none, gravity or coulomb).\n";
+            return false;
+        }
+        params.pairForce = options.pairForce;
+    }
+    if (!options.forceMode.empty()) {
+        ForceMode mode;
+        if (!Simulator::parseForceMode(options.forceMode, mode)) {
+            std::cerr << "Error: Unknown force mode '" << options.forceMode << "' (expected constant or per_step).\n";
+            return false;
+        }
+        params.forceMode = options.forceMode;
+    }
+    if (!options.precision.empty()) {
+        Precision type;
+        if (!Simulator::parsePrecision(options.precision, type)) {
+            std::cerr << "Error: Unknown precision '" << options.precision << "' (expected double or float).\n";
+            return false;
+        }
+        params.precision = options.precision;
+    }
+    if (options.dt > 0.0) {
+        params.dt = options.dt;
+    }
+    if (options.outputInterval > 0.0) {
+        params.outputInterval = options.outputInterval;
+    }
+    if (options.checkpointInterval > 0.0) {
+        params.checkpointInterval = options.checkpointInterval;
+    }
+    if (!options.checkpointFile.empty()) {
+        params.checkpointFile = options.checkpointFile;
+    }
+    if (options.resume) {
+        params.resume = true;
+    }
+    if (options.hasSeed) {
+        params.seed = options.seed;
+        params.hasSeed = true;
+    }
+    if (options.profile) {
+        params.profile = true;
+    }
+    if (!options.profileOutput.empty()) {
+        params.profileOutput = options.profileOutput;
+    }
+    if (options.printStride > 0) {
+        params.printPointStride = options.printStride;
+    }
+    if (options.printInterval > 0) {
+        params.printTimeStride = options.printInterval;
+    }
+    if (!options.outputFormat.empty()) {
+        TextFormat format;
+        if (!TextFrameSink::parseFormat(options.outputFormat, format)) {
+            std::cerr << "Error: Unknown output format '" << options.outputFormat << "' (expected text, csv or tsv).\n";
+            return false;
+        }
+        params.outputFormat = options.outputFormat;
+    }
+    
+    if (params.cubeSize <= 0 || params.numPoints <= 0 || params.numForces <= 0 || params.simulationTime < 0) {
+        std::cerr << "Error: Invalid parameter values. All values must be positive (except T which can be 0).\n";
+        return false;
+    }
+    
+    if (params.minFriction > params.maxFriction || 
+        params.minAcceleration > params.maxAcceleration ||
+        params.minVelocity > params.maxVelocity ||
+        params.minInitialVelocity > params.maxInitialVelocity) {
+        std::cerr << "Error: Minimum values cannot be greater than maximum values.\n";
+        return false;
+    }
+    
+    if (!(params.dt > 0) || !(params.outputInterval > 0)) {
+        std::cerr << "Error: dt and output interval must be positive.\n";
+        return false;
+    }
+    
+    if (params.forceResampleInterval < 0) {
+        std::cerr << "Error: Force resample interval cannot be negative.\n";
+        return false;
+    }
+    
+    if (params.checkpointInterval < 0) {
+        std::cerr << "Error: Checkpoint interval cannot be negative.\n";
+        return false;
+    }
+    
+    if (params.interactionRadius < 0 || params.interactionStiffness < 0 || params.interactionDamping < 0) {
+        std::cerr << "Error: Interaction radius, stiffness and damping cannot be negative.\n";
+        return false;
+    }
+    
+    if (!(params.pairSoftening > 0) || params.openingAngle < 0) {
+        std::cerr << "Error: Pair force softening must be positive and the opening angle cannot be negative.\n";
+        return false;
+    }
+    
+    return true;
+}
+
+
+// Runs every simulation of a sweep file on one shared pool and prints a
+// summary table; positions and other outputs go to per-run files.
+int runSweep(const std::string& filename, const RunOptions& options) {
+    std::vector<SweepRun> runs;
+    if (!ConfigParser::parseSweepFile(filename, runs)) {
+        std::cerr << "Error: Failed to parse config file: " << filename << std::endl;
+        return 1;
+    }
+    
+    bool profiled = false;
+    for (SweepRun& run : runs) {
+        if (!applyOptions(options, run.params)) {
+            std::cerr << "Error: Invalid parameters in run '" << run.name << "' of " << filename << std::endl;
+            return 1;
+        }
+        profiled = profiled || run.params.profile;
+        // The profiler is process-wide, so it cannot separate the runs.
+        run.params.profile = false;
+    }
+    if (profiled) {
+        std::cerr << "Warning: profiling is not supported in sweeps, ignoring profile request" << std::endl;
+    }
+    Sweep::assignOutputs(runs);
+    
+    // The runs share one pool, so the first run's (shared) thread count is used.
+    const int threads = runs.front().params.threads;
+    const unsigned poolSize = threads > 0 ? static_cast<unsigned>(threads) : ThreadPool::hardwareThreads();
+    
+    std::cout << "3D Physics Point Simulation\n";
+    std::cout << "============================\n";
+    std::cout << "Sweep: " << runs.size() << " runs from " << filename << "\n";
+    std::cout << "Integration kernel: " << IntegrationKernel::isaName(IntegrationKernel::activeIsa()) << "\n";
+    std::cout << "Threads: " << poolSize << "\n";
+    std::cout << "\n";
+    std::cout.flush();
+    
+    Sweep::SinkFactory addSinks;
+#ifdef POINTSIM_HAVE_VTK
+    addSinks = VTKWriter::addSinks;
+#else
+    if (std::any_of(runs.begin(), runs.end(), [](const SweepRun& run) { return run.params.enableVTKOutput; })) {
+        std::cerr << "Warning: Built without VTK support, ignoring VTK output file.\n";
+    }
+#endif
+    
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<SweepResult> results = Sweep::run(runs, poolSize, addSinks);
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    Sweep::printSummary(results, wallSeconds, poolSize, std::cout);
+    const bool failed = std::any_of(results.begin(), results.end(), [](const SweepResult& result) { return !result.error.empty(); });
+    return failed ? 1 : 0;
+}
+
+}
+
+void CommandLine::printUsage() {
+    std::cout << "Usage: 3DPointSimulator [options]\n";
+    std::cout << "   OR: 3DPointSimulator <config_file>\n";
+    std::cout << "   OR: 3DPointSimulator <sweep_file>  (config with [run] sections or {a, b, ...} values)\n";
+    std::cout << "   OR: 3DPointSimulator <L> <N> <a1> <a2> <M> <amin> <amax> <vmin> <vmax> <v0min> <v0max> <T> [vtk_output_file]\n";
+    std::cout << "   OR: 3DPointSimulator convert <trajectory_file> <vtk_output_file>\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --gui, -g       - Launch graphical user interface (GUI build only)\n";
+    std::cout << "  --threads <n>   - Worker threads (0 = all hardware threads, overrides config)\n";
+    std::cout << "  --quiet, -q     - Do not print point positions\n";
+    std::cout << "  --print-stride <k>   - Print every k-th point\n";
+    std::cout << "  --print-interval <k> - Print every k-th output time\n";
+    std::cout << "  --format <fmt>  - Position output layout: text (default), csv or tsv\n";
+    std::cout << "  --seed <n>      - Random seed; the same seed reproduces the same run\n";
+    std::cout << "  --integrator <name> - euler, semi_implicit (default), verlet, rk4 or exact\n";
+    std::cout << "  --boundary <mode> - Cube walls: none (default), reflect, periodic or absorb\n";
+    std::cout << "  --pair-force <kind> - Long-range force between all points: none (default), gravity or coulomb\n";
+    std::cout << "  --dt <s>        - Integration time step (default 0.01)\n";
+    std::cout << "  --force-mode <mode> - constant (default) or per_step force magnitudes\n";
+    std::cout << "  --precision <type> - Particle state as double (default) or float\n";
+    std::cout << "  --output-interval <s> - Simulated time between outputs (default 1)\n";
+    std::cout << "  --checkpoint-interval <s> - Save the simulation state every s simulated seconds\n";
+    std::cout << "  --checkpoint-file <file> - Checkpoint file (default pointsim_checkpoint.bin)\n";
+    std::cout << "  --resume        - Continue from the checkpoint file\n";
+    std::cout << "  --profile       - Time each phase and write a report (pointsim_profile.json)\n";
+    std::cout << "  --profile-output <file> - Profile report file; .csv selects CSV, otherwise JSON\n\n";
+    std::cout << "Config file mode:\n";
+    std::cout << "  config_file     - Configuration file (.cfg, .config, or .conf extension)\n\n";
+    std::cout << "Command line mode parameters:\n";
+    std::cout << "  L               - Cube side length\n";
+    std::cout << "  N               - Number of points\n";
+    std::cout << "  a1              - Minimum friction coefficient\n";
+    std::cout << "  a2              - Maximum friction coefficient\n";
+    std::cout << "  M               - Number of forces\n";
+    std::cout << "  amin            - Minimum acceleration\n";
+    std::cout << "  amax            - Maximum acceleration\n";
+    std::cout << "  vmin            - Minimum velocity\n";
+    std::cout << "  vmax            - Maximum velocity\n";
+    std::cout << "  v0min           - Minimum initial velocity\n";
+    std::cout << "  v0max           - Maximum initial velocity\n";
+    std::cout << "  T               - Simulation duration (seconds)\n";
+    std::cout << "  vtk_output_file - Optional VTK output filename (without extension)\n";
+}
+
+bool CommandLine::isGuiRequest(int argc, char* argv[]) {
+    return argc == 1 || (argc == 2 && (std::string(argv[1]) == "--gui" || std::string(argv[1]) == "-g"));
+}
+
+int CommandLine::run(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    RunOptions options;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const bool takesValue = arg == "--threads" || arg == "-j" || arg == "--print-stride" ||
+                                arg == "--print-interval" || arg == "--format" || arg == "--profile-output" ||
+                                arg == "--seed" || arg == "--integrator" || arg == "--boundary" || arg == "--pair-force" || arg == "--force-mode" || arg == "--precision" || arg == "--dt" || arg == "--output-interval" ||
+                                arg == "--checkpoint-interval" || arg == "--checkpoint-file";
+        if (takesValue && i + 1 >= argc) {
+            std::cerr << "Error: " << arg << " requires a value.\n\n";
+            printUsage();
+            return 1;
+        }
+        
+        if (arg == "--threads" || arg == "-j") {
+            if (!parseIntOption(arg, argv[++i], 0, options.threads)) {
+                return 1;
+            }
+        } else if (arg == "--quiet" || arg == "-q") {
+            options.quiet = true;
+        } else if (arg == "--print-stride") {
+            if (!parseIntOption(arg, argv[++i], 1, options.printStride)) {
+                return 1;
+            }
+        } else if (arg == "--print-interval") {
+            if (!parseIntOption(arg, argv[++i], 1, options.printInterval)) {
+                return 1;
+            }
+        } else if (arg == "--format") {
+            options.outputFormat = argv[++i];
+        } else if (arg == "--integrator") {
+            options.integrator = argv[++i];
+        } else if (arg == "--boundary") {
+            options.boundary = argv[++i];
+        } else if (arg == "--pair-force") {
+            options.pairForce = argv[++i];
+        } else if (arg == "--force-mode") {
+            options.forceMode = argv[++i];
+        } else if (arg == "--precision") {
+            options.precision = argv[++i];
+        } else if (arg == "--dt") {
+            if (!parseDoubleOption(arg, argv[++i], options.dt)) {
+                return 1;
+            }
+        } else if (arg == "--output-interval") {
+            if (!parseDoubleOption(arg, argv[++i], options.outputInterval)) {
+                return 1;
+            }
+        } else if (arg == "--checkpoint-interval") {
+            if (!parseDoubleOption(arg, argv[++i], options.checkpointInterval)) {
+                return 1;
+            }
+        } else if (arg == "--checkpoint-file") {
+            options.checkpointFile = argv[++i];
+        } else if (arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "--seed") {
+            const std::string text = argv[++i];
+            if (!Simulator::parseSeed(text, options.seed)) {
+                std::cerr << "Error: --seed expects a whole number from 0 to 18446744073709551615, got '" << text << "'.\n";
+                return 1;
+            }
+            options.hasSeed = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--profile-output") {
+            options.profile = true;
+            options.profileOutput = argv[++i];
+        } else {
+            args.push_back(arg);
+        }
+    }
+    
+    if (!args.empty() && args[0] == "convert") {
+        if (args.size() != 3) {
+            std::cerr << "Error: convert expects <trajectory_file> <vtk_output_file>.\n\n";
+            printUsage();
+            return 1;
+        }
+#ifdef POINTSIM_HAVE_VTK
+        try {
+            TrajectoryReader reader(args[1]);
+            VTKWriter::writeTrajectory(reader, args[2]);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+#else
+        std::cerr << "Error: convert requires a build with VTK support.\n";
+        return 1;
+#endif
+    }
+    
+    if (args.size() == 1 && (args[0] == "--gui" || args[0] == "-g")) {
+        std::cerr << "Error: This executable was built without the GUI.\n";
+        return 1;
+    }
+    
+    if (args.size() != 1 && args.size() != 12 && args.size() != 13) {
+        std::cerr << "Error: Incorrect number of arguments.\n\n";
+        printUsage();
+        return 1;
+    }
+    
+    SimulationParams params;
+    try {
+        // Check if using config file mode
+        if (args.size() == 1) {
+            const std::string& arg = args[0];
+            if (ConfigParser::isConfigFile(arg) && ConfigParser::isSweepFile(arg)) {
+                return runSweep(arg, options);
+            } else if (ConfigParser::isConfigFile(arg)) {
+                if (!ConfigParser::parseConfigFile(arg, params)) {
+                    std::cerr << "Error: Failed to parse config file: " << arg << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Single argument must be a config file (.cfg, .config, or .conf)\n\n";
+                printUsage();
+                return 1;
+            }
+        } else {
+            // Command line parameter mode
+            params.cubeSize = std::stod(args[0]);
+            params.numPoints = std::stoi(args[1]);
+            params.minFriction = std::stod(args[2]);
+            params.maxFriction = std::stod(args[3]);
+            params.numForces = std::stoi(args[4]);
+            params.minAcceleration = std::stod(args[5]);
+            params.maxAcceleration = std::stod(args[6]);
+            params.minVelocity = std::stod(args[7]);
+            params.maxVelocity = std::stod(args[8]);
+            params.minInitialVelocity = std::stod(args[9]);
+            params.maxInitialVelocity = std::stod(args[10]);
+            params.simulationTime = std::stoi(args[11]);
+            
+            params.enableVTKOutput = (args.size() == 13);
+            params.vtkOutputFile = params.enableVTKOutput ? args[12] : "";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing arguments: " << e.what() << "\n\n";
+        printUsage();
+        return 1;
+    }
+    
+    if (!applyOptions(options, params)) {
+        return 1;
+    }
+    
+    std::cout << "3D Physics Point Simulation\n";
+    std::cout << "============================\n";
+    std::cout << "Cube size: " << params.cubeSize << "\n";
+    std::cout << "Number of points: " << params.numPoints << "\n";
+    std::cout << "Friction range: [" << params.minFriction << ", " << params.maxFriction << "]\n";
+    std::cout << "Number of forces: " << params.numForces << "\n";
+    std::cout << "Acceleration range: [" << params.minAcceleration << ", " << params.maxAcceleration << "]\n";
+    std::cout << "Velocity range: [" << params.minVelocity << ", " << params.maxVelocity << "]\n";
+    std::cout << "Initial velocity range: [" << params.minInitialVelocity << ", " << params.maxInitialVelocity << "]\n";
+    std::cout << "Simulation time: " << params.simulationTime << " seconds\n";
+    if (params.enableVTKOutput) {
+        std::cout << "VTK output file: " << params.vtkOutputFile << "\n";
+    }
+    
+    // Errors from here on come from the run itself, such as a missing or
+    // mismatched checkpoint or a failed write, not from the arguments.
+    try {
+        Simulator simulator(params);
+        if (params.enableVTKOutput && !params.vtkOutputFile.empty()) {
+#ifdef POINTSIM_HAVE_VTK
+            VTKWriter::addSinks(simulator, params);
+#else
+            std::cerr << "Warning: Built without VTK support, ignoring VTK output file.\n";
+#endif
+        }
+        std::cout << "Integration kernel: " << IntegrationKernel::isaName(IntegrationKernel::activeIsa()) << "\n";
+        std::cout << "Integrator: " << IntegrationKernel::schemeName(simulator.integrationScheme());
+        if (simulator.integrationScheme() != IntegrationScheme::Exact) {
+            std::cout << ", dt " << simulator.timeStep() << " s";
+        }
+        std::cout << ", output every " << params.outputInterval << " s\n";
+        std::cout << "Boundary: " << IntegrationKernel::boundaryName(simulator.boundaryMode()) << "\n";
+        if (simulator.scalarPrecision() == Precision::Float) {
+            std::cout << "Precision: " << Simulator::precisionName(simulator.scalarPrecision()) << "\n";
+        }
+        if (simulator.forceResampleSteps() > 0) {
+            std::cout << "Forces: redrawn every " << simulator.forceResampleSteps() * simulator.timeStep() << " s\n";
+        }
+        if (simulator.hasInteractions()) {
+            std::cout << "Interactions: radius " << params.interactionRadius << ", stiffness " << params.interactionStiffness
+                      << ", damping " << params.interactionDamping << "\n";
+        }
+        if (simulator.hasPairForces()) {
+            std::cout << "Pair force: " << params.pairForce << ", strength " << params.pairStrength << ", softening "
+                      << params.pairSoftening << ", opening angle " << params.openingAngle << "\n";
+        }
+        if (params.checkpointInterval > 0) {
+            std::cout << "Checkpoints: every " << params.checkpointInterval << " s to " << params.checkpointFile << "\n";
+        }
+        if (simulator.writesGrid()) {
+            std::cout << "Voxel grid: " << params.voxelGrid << "^3 cells\n";
+        }
+        if (simulator.sampleSize() > 0) {
+            std::cout << "Subsample: " << simulator.sampleSize() << " of " << params.numPoints << " points\n";
+        }
+        if (simulator.resumedTime() >= 0) {
+            std::cout << "Resumed from: " << params.checkpointFile << " at " << simulator.resumedTime() << " s\n";
+        }
+        std::cout << "Threads: " << simulator.threadCount() << "\n";
+        std::cout << "Seed: " << simulator.seed() << "\n";
+        std::cout << "\n";
+        
+        simulator.simulate();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    
+    return 0;
+}
\ No newline at end of file
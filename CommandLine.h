@@ -0,0 +1,11 @@
+#pragma once
+
+// Command-line front-end: config file and positional parameter modes, the
+// convert subcommand and the run options. Used by 3DPointSimulator-cli and by
+// the GUI executable when it is started with arguments.
+class CommandLine {
+public:
+    static int run(int argc, char* argv[]);
+    static bool isGuiRequest(int argc, char* argv[]);
+    static void printUsage();
+};
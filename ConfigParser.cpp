@@ -1,8 +1,37 @@
 #include "ConfigParser.h"
+#include "IntegrationKernel.h"
+#include "BarnesHut.h"
+#include "TextFrameSink.h"
+#include "VTKOptions.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+struct SweepEntry {
+    std::string key;
+    std::string value;
+    int lineNumber;
+};
+
+struct SweepSection {
+    std::string name;
+    std::vector<SweepEntry> entries;
+};
+
+bool isRunName(const std::string& name) {
+    return !name.empty() && std::all_of(name.begin(), name.end(), [](unsigned char ch) {
+        return std::isalnum(ch) || ch == '_' || ch == '-' || ch == '.';
+    });
+}
+
+}
 
 bool ConfigParser::parseConfigFile(const std::string& filename, SimulationParams& params) {
     std::ifstream file(filename);
@@ -32,34 +61,7 @@ bool ConfigParser::parseConfigFile(const std::string& filename, SimulationParams
         }
         
         try {
-            if (key == "cube_size" || key == "L") {
-                params.cubeSize = std::stod(value);
-            } else if (key == "num_points" || key == "N") {
-                params.numPoints = std::stoi(value);
-            } else if (key == "min_friction" || key == "a1") {
-                params.minFriction = std::stod(value);
-            } else if (key == "max_friction" || key == "a2") {
-                params.maxFriction = std::stod(value);
-            } else if (key == "num_forces" || key == "M") {
-                params.numForces = std::stoi(value);
-            } else if (key == "min_acceleration" || key == "amin") {
-                params.minAcceleration = std::stod(value);
-            } else if (key == "max_acceleration" || key == "amax") {
-                params.maxAcceleration = std::stod(value);
-            } else if (key == "min_velocity" || key == "vmin") {
-                params.minVelocity = std::stod(value);
-            } else if (key == "max_velocity" || key == "vmax") {
-                params.maxVelocity = std::stod(value);
-            } else if (key == "min_initial_velocity" || key == "v0min") {
-                params.minInitialVelocity = std::stod(value);
-            } else if (key == "max_initial_velocity" || key == "v0max") {
-                params.maxInitialVelocity = std::stod(value);
-            } else if (key == "simulation_time" || key == "T") {
-                params.simulationTime = std::stoi(value);
-            } else if (key == "vtk_output_file") {
-                params.vtkOutputFile = value;
-                params.enableVTKOutput = !value.empty();
-            } else {
+            if (!setParameter(key, value, params)) {
                 std::cerr << "Warning: Unknown parameter '" << key << "' on line " << lineNumber << std::endl;
             }
         } catch (const std::exception& e) {
@@ -72,6 +74,372 @@ bool ConfigParser::parseConfigFile(const std::string& filename, SimulationParams
     return true;
 }
 
+bool ConfigParser::isSweepFile(const std::string& filename) {
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line[0] == '[' || parseLine(line).second.compare(0, 1, "{") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConfigParser::parseSweepFile(const std::string& filename, std::vector<SweepRun>& runs) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open config file: " << filename << std::endl;
+        return false;
+    }
+    
+    // Entries are checked as they are read, so expanding them below cannot
+    // fail and every message carries its line number.
+    std::vector<SweepEntry> shared;
+    std::vector<SweepSection> sections;
+    std::string line;
+    int lineNumber = 0;
+    
+    while (std::getline(file, line)) {
+        lineNumber++;
+        trim(line);
+        
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        
+        if (line[0] == '[') {
+            const std::size_t close = line.find(']');
+            std::string header = close == std::string::npos ? "" : line.substr(1, close - 1);
+            trim(header);
+            std::string name = header.size() > 3 ? header.substr(3) : "";
+            trim(name);
+            if (header.compare(0, 3, "run") != 0 || (header.size() > 3 && !std::isspace(static_cast<unsigned char>(header[3])))) {
+                std::cerr << "Error: Unknown section '" << line << "' on line " << lineNumber << " (expected [run] or [run <name>])" << std::endl;
+                return false;
+            }
+            if (name.empty()) {
+                name = "run" + std::to_string(sections.size() + 1);
+            } else if (!isRunName(name)) {
+                std::cerr << "Error: Invalid run name '" << name << "' on line " << lineNumber
+                          << " (letters, digits, '_', '-' and '.' only)" << std::endl;
+                return false;
+            }
+            sections.push_back({name, {}});
+            continue;
+        }
+        
+        auto [key, value] = parseLine(line);
+        if (key.empty()) {
+            std::cerr << "Warning: Invalid line " << lineNumber << " in config file: " << line << std::endl;
+            continue;
+        }
+        
+        std::vector<std::string> values;
+        if (value.compare(0, 1, "{") == 0) {
+            if (!parseList(value, values)) {
+                std::cerr << "Error: Invalid value list '" << value << "' for parameter '" << key
+                          << "' on line " << lineNumber << std::endl;
+                return false;
+            }
+        } else {
+            values.push_back(value);
+        }
+        try {
+            SimulationParams scratch;
+            bool known = true;
+            for (const std::string& v : values) {
+                known = setParameter(key, v, scratch);
+            }
+            if (!known) {
+                std::cerr << "Warning: Unknown parameter '" << key << "' on line " << lineNumber << std::endl;
+                continue;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Invalid value '" << value << "' for parameter '" << key
+                      << "' on line " << lineNumber << std::endl;
+            return false;
+        }
+        
+        (sections.empty() ? shared : sections.back().entries).push_back({key, value, lineNumber});
+    }
+    
+    if (sections.empty()) {
+        sections.push_back({"run", {}});
+    }
+    
+    runs.clear();
+    std::set<std::string> names;
+    for (const SweepSection& section : sections) {
+        // A section's own value replaces the shared one, list or not.
+        std::vector<SweepEntry> entries;
+        for (const SweepEntry& entry : shared) {
+            const bool overridden = std::any_of(section.entries.begin(), section.entries.end(),
+                                                [&](const SweepEntry& own) { return own.key == entry.key; });
+            if (!overridden) {
+                entries.push_back(entry);
+            }
+        }
+        entries.insert(entries.end(), section.entries.begin(), section.entries.end());
+        
+        std::vector<std::vector<std::string>> choices(entries.size());
+        std::size_t combinations = 1;
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].value.compare(0, 1, "{") == 0) {
+                parseList(entries[i].value, choices[i]);
+            } else {
+                choices[i].push_back(entries[i].value);
+            }
+            combinations *= choices[i].size();
+        }
+        
+        // The last swept key varies fastest.
+        for (std::size_t combination = 0; combination < combinations; ++combination) {
+            SweepRun run;
+            run.params.enableVTKOutput = false;
+            run.params.vtkOutputFile = "";
+            run.name = combinations > 1 ? section.name + "-" + std::to_string(combination + 1) : section.name;
+            std::vector<std::size_t> pick(entries.size());
+            std::size_t rest = combination;
+            for (std::size_t i = entries.size(); i-- > 0;) {
+                pick[i] = rest % choices[i].size();
+                rest /= choices[i].size();
+            }
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                const std::string& value = choices[i][pick[i]];
+                setParameter(entries[i].key, value, run.params);
+                if (choices[i].size() > 1) {
+                    run.label += (run.label.empty() ? "" : " ") + entries[i].key + "=" + value;
+                }
+            }
+            if (!names.insert(run.name).second) {
+                std::cerr << "Error: Duplicate run name '" << run.name << "' in config file" << std::endl;
+                return false;
+            }
+            runs.push_back(std::move(run));
+        }
+    }
+    
+    return true;
+}
+
+bool ConfigParser::parseList(const std::string& value, std::vector<std::string>& values) {
+    const std::size_t close = value.find('}');
+    if (value.empty() || value[0] != '{' || close == std::string::npos) {
+        return false;
+    }
+    values.clear();
+    std::stringstream items(value.substr(1, close - 1));
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        trim(item);
+        const std::size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            if (item.empty()) {
+                return false;
+            }
+            values.push_back(item);
+            continue;
+        }
+        // first:step:last, inclusive; each value is computed from the start
+        // so rounding does not accumulate.
+        const std::size_t secondColon = item.find(':', colon + 1);
+        if (secondColon == std::string::npos) {
+            return false;
+        }
+        double first, step, last;
+        try {
+            first = std::stod(item.substr(0, colon));
+            step = std::stod(item.substr(colon + 1, secondColon - colon - 1));
+            last = std::stod(item.substr(secondColon + 1));
+        } catch (const std::exception&) {
+            return false;
+        }
+        const double span = (last - first) / step;
+        if (!(step != 0.0) || !(span >= 0.0) || span > 1e6) {
+            return false;
+        }
+        const long count = static_cast<long>(std::floor(span + 1e-9)) + 1;
+        for (long i = 0; i < count; ++i) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.15g", first + static_cast<double>(i) * step);
+            values.push_back(buffer);
+        }
+    }
+    return !values.empty();
+}
+
+bool ConfigParser::setParameter(const std::string& key, const std::string& value, SimulationParams& params) {
+    if (key == "cube_size" || key == "L") {
+        params.cubeSize = std::stod(value);
+    } else if (key == "num_points" || key == "N") {
+        params.numPoints = std::stoi(value);
+    } else if (key == "min_friction" || key == "a1") {
+        params.minFriction = std::stod(value);
+    } else if (key == "max_friction" || key == "a2") {
+        params.maxFriction = std::stod(value);
+    } else if (key == "num_forces" || key == "M") {
+        params.numForces = std::stoi(value);
+    } else if (key == "min_acceleration" || key == "amin") {
+        params.minAcceleration = std::stod(value);
+    } else if (key == "max_acceleration" || key == "amax") {
+        params.maxAcceleration = std::stod(value);
+    } else if (key == "min_velocity" || key == "vmin") {
+        params.minVelocity = std::stod(value);
+    } else if (key == "max_velocity" || key == "vmax") {
+        params.maxVelocity = std::stod(value);
+    } else if (key == "min_initial_velocity" || key == "v0min") {
+        params.minInitialVelocity = std::stod(value);
+    } else if (key == "max_initial_velocity" || key == "v0max") {
+        params.maxInitialVelocity = std::stod(value);
+    } else if (key == "simulation_time" || key == "T") {
+        params.simulationTime = std::stoi(value);
+    } else if (key == "vtk_output_file") {
+        params.vtkOutputFile = value;
+        params.enableVTKOutput = !value.empty();
+    } else if (key == "vtk_pieces") {
+        const int pieces = std::stoi(value);
+        if (pieces < 0) {
+            throw std::invalid_argument(value);
+        }
+        params.vtkPieces = pieces;
+    } else if (key == "vtk_encoding") {
+        VTKEncoding encoding;
+        if (!VTKOutputOptions::parseEncoding(value, encoding)) {
+            throw std::invalid_argument(value);
+        }
+        params.vtkEncoding = value;
+    } else if (key == "vtk_compression") {
+        VTKCompression compression;
+        if (!VTKOutputOptions::parseCompression(value, compression)) {
+            throw std::invalid_argument(value);
+        }
+        params.vtkCompression = value;
+    } else if (key == "vtk_compression_level") {
+        const int level = std::stoi(value);
+        if (level < 1 || level > 9) {
+            throw std::invalid_argument(value);
+        }
+        params.vtkCompressionLevel = level;
+    } else if (key == "kernel") {
+        KernelIsa isa;
+        if (!IntegrationKernel::parseIsa(value, isa)) {
+            throw std::invalid_argument(value);
+        }
+        params.kernel = value;
+    } else if (key == "threads") {
+        params.threads = std::stoi(value);
+    } else if (key == "output_queue_depth") {
+        params.outputQueueDepth = std::stoi(value);
+    } else if (key == "output_threads") {
+        params.outputThreads = std::stoi(value);
+    } else if (key == "trajectory_file") {
+        params.trajectoryFile = value;
+    } else if (key == "trajectory_precision") {
+        if (value != "float" && value != "double") {
+            throw std::invalid_argument(value);
+        }
+        params.trajectoryFloat32 = (value == "float");
+    } else if (key == "trajectory_delta") {
+        params.trajectoryDelta = parseBool(value);
+    } else if (key == "trajectory_keyframe_interval") {
+        params.trajectoryKeyframeInterval = std::stoi(value);
+    } else if (key == "checkpoint_interval") {
+        params.checkpointInterval = std::stod(value);
+    } else if (key == "checkpoint_file") {
+        params.checkpointFile = value;
+    } else if (key == "voxel_grid") {
+        const int resolution = std::stoi(value);
+        if (resolution < 0 || resolution > 1024) {
+            throw std::invalid_argument(value);
+        }
+        params.voxelGrid = resolution;
+    } else if (key == "subsample") {
+        const int count = std::stoi(value);
+        if (count < 0) {
+            throw std::invalid_argument(value);
+        }
+        params.subsample = count;
+    } else if (key == "quiet") {
+        params.quiet = parseBool(value);
+    } else if (key == "print_point_stride") {
+        params.printPointStride = std::stoi(value);
+    } else if (key == "print_time_stride") {
+        params.printTimeStride = std::stoi(value);
+    } else if (key == "output_format") {
+        TextFormat format;
+        if (!TextFrameSink::parseFormat(value, format)) {
+            throw std::invalid_argument(value);
+        }
+        params.outputFormat = value;
+    } else if (key == "integrator") {
+        IntegrationScheme scheme;
+        if (!IntegrationKernel::parseScheme(value, scheme)) {
+            throw std::invalid_argument(value);
+        }
+        params.integrator = value;
+    } else if (key == "boundary") {
+        BoundaryMode boundary;
+        if (!IntegrationKernel::parseBoundary(value, boundary)) {
+            throw std::invalid_argument(value);
+        }
+        params.boundary = value;
+    } else if (key == "interaction_radius") {
+        params.interactionRadius = std::stod(value);
+    } else if (key == "interaction_stiffness") {
+        params.interactionStiffness = std::stod(value);
+    } else if (key == "interaction_damping") {
+        params.interactionDamping = std::stod(value);
+    } else if (key == "pair_force") {
+        PairForce kind;
+        if (!BarnesHut::parseKind(value, kind)) {
+            throw std::invalid_argument(value);
+        }
+        params.pairForce = value;
+    } else if (key == "pair_strength") {
+        params.pairStrength = std::stod(value);
+    } else if (key == "pair_softening") {
+        params.pairSoftening = std::stod(value);
+    } else if (key == "opening_angle") {
+        params.openingAngle = std::stod(value);
+    } else if (key == "force_mode") {
+        ForceMode mode;
+        if (!Simulator::parseForceMode(value, mode)) {
+            throw std::invalid_argument(value);
+        }
+        params.forceMode = value;
+    } else if (key == "force_resample_interval") {
+        params.forceResampleInterval = std::stod(value);
+    } else if (key == "precision") {
+        Precision precision;
+        if (!Simulator::parsePrecision(value, precision)) {
+            throw std::invalid_argument(value);
+        }
+        params.precision = value;
+    } else if (key == "dt") {
+        params.dt = std::stod(value);
+    } else if (key == "output_interval") {
+        params.outputInterval = std::stod(value);
+    } else if (key == "seed") {
+        if (!Simulator::parseSeed(value, params.seed)) {
+            throw std::invalid_argument(value);
+        }
+        params.hasSeed = true;
+    } else if (key == "profile") {
+        params.profile = parseBool(value);
+    } else if (key == "output_prefix") {
+        params.outputPrefix = value;
+    } else if (key == "profile_output") {
+        params.profileOutput = value;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 bool ConfigParser::isConfigFile(const std::string& filename) {
     size_t dotPos = filename.find_last_of('.');
     if (dotPos == std::string::npos) {
@@ -84,6 +452,19 @@ bool ConfigParser::isConfigFile(const std::string& filename) {
     return (extension == "cfg" || extension == "config" || extension == "conf");
 }
 
+bool ConfigParser::parseBool(const std::string& value) {
+    std::string lower = value;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    
+    if (lower == "true" || lower == "yes" || lower == "on" || lower == "1") {
+        return true;
+    }
+    if (lower == "false" || lower == "no" || lower == "off" || lower == "0") {
+        return false;
+    }
+    throw std::invalid_argument(value);
+}
+
 void ConfigParser::trim(std::string& str) {
     str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](unsigned char ch) {
         return !std::isspace(ch);
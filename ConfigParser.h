@@ -1,13 +1,25 @@
 #pragma once
 #include "Simulator.h"
+#include "Sweep.h"
 #include <string>
+#include <vector>
 
 class ConfigParser {
 public:
     static bool parseConfigFile(const std::string& filename, SimulationParams& params);
     static bool isConfigFile(const std::string& filename);
+    // True if the file has [run] sections or {list} values.
+    static bool isSweepFile(const std::string& filename);
+    // Keys before the first [run <name>] section apply to every run. A value
+    // written as {a, b, c} or {first:step:last} is swept: the run is repeated
+    // for every value, crossed with its other swept keys.
+    static bool parseSweepFile(const std::string& filename, std::vector<SweepRun>& runs);
     
 private:
+    // Returns false for an unknown key; throws on an invalid value.
+    static bool setParameter(const std::string& key, const std::string& value, SimulationParams& params);
+    static bool parseList(const std::string& value, std::vector<std::string>& values);
     static void trim(std::string& str);
+    static bool parseBool(const std::string& value);
     static std::pair<std::string, std::string> parseLine(const std::string& line);
 };
\ No newline at end of file
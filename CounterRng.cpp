@@ -0,0 +1,73 @@
+#include "CounterRng.h"
+#include "IntegrationKernel.h"
+#include "IntegrationKernelImpl.h"
+
+void uniformPairsScalar(const RandomBatch& batch) {
+    for (std::size_t j = 0; j < batch.count; ++j) {
+        const std::uint64_t index = batch.firstIndex + (batch.indices ? batch.indices[j] : j);
+        const std::uint32_t in[4] = {static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32),
+                                     batch.stream, batch.block};
+        std::uint32_t out[4];
+        CounterRng::philox(in, batch.key, out);
+        if (batch.third) {
+            batch.first[j] = CounterRng::toUniform32(out[0]);
+            batch.second[j] = CounterRng::toUniform32(out[1]);
+            batch.third[j] = CounterRng::toUniform32(out[2]);
+            batch.fourth[j] = CounterRng::toUniform32(out[3]);
+            continue;
+        }
+        batch.first[j] = CounterRng::toUniform(out[0], out[1]);
+        batch.second[j] = CounterRng::toUniform(out[2], out[3]);
+    }
+}
+
+namespace {
+
+void generate(const RandomBatch& batch) {
+    switch (IntegrationKernel::activeIsa()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case KernelIsa::AVX512: uniformPairsAVX512(batch); break;
+        case KernelIsa::AVX2: uniformPairsAVX2(batch); break;
+#endif
+        default: uniformPairsScalar(batch); break;
+    }
+}
+
+}
+
+void CounterRng::uniformPairs(std::uint64_t seed, RngStream stream, std::uint64_t firstIndex, std::size_t count,
+                              std::uint32_t block, double* first, double* second) {
+    const RandomBatch batch = {
+        {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+        static_cast<std::uint32_t>(stream), block, firstIndex, nullptr, count, first, second, nullptr, nullptr
+    };
+    generate(batch);
+}
+
+void CounterRng::uniformPairsAt(std::uint64_t seed, RngStream stream, std::uint64_t baseIndex, const std::uint32_t* indices,
+                                std::size_t count, std::uint32_t block, double* first, double* second) {
+    const RandomBatch batch = {
+        {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+        static_cast<std::uint32_t>(stream), block, baseIndex, indices, count, first, second, nullptr, nullptr
+    };
+    generate(batch);
+}
+
+void CounterRng::uniformQuads(std::uint64_t seed, RngStream stream, std::uint64_t firstIndex, std::size_t count,
+                              std::uint32_t block, double* first, double* second, double* third, double* fourth) {
+    const RandomBatch batch = {
+        {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+        static_cast<std::uint32_t>(stream), block, firstIndex, nullptr, count, first, second, third, fourth
+    };
+    generate(batch);
+}
+
+void CounterRng::uniformQuadsAt(std::uint64_t seed, RngStream stream, std::uint64_t baseIndex, const std::uint32_t* indices,
+                                std::size_t count, std::uint32_t block, double* first, double* second, double* third,
+                                double* fourth) {
+    const RandomBatch batch = {
+        {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+        static_cast<std::uint32_t>(stream), block, baseIndex, indices, count, first, second, third, fourth
+    };
+    generate(batch);
+}
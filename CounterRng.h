@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Independent random streams used by the simulator. A stream together with
+// the seed and an index (point or force number) selects a sequence that does
+// not depend on any other draw.
+enum class RngStream : std::uint32_t {
+    Force = 1,
+    Position = 2,
+    Velocity = 3,
+    Friction = 4,
+    PointForce = 5,
+    Sample = 6
+};
+
+// Counter-based generator built on Philox4x32-10 (Salmon et al., "Parallel
+// Random Numbers: As Easy as 1, 2, 3", SC'11). The output is a pure function
+// of (seed, stream, index, draw number), so any point's values can be
+// produced on any thread, in any order, with identical results.
+class CounterRng {
+public:
+    CounterRng(std::uint64_t seed, RngStream stream, std::uint64_t index)
+        : key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+          counter{static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32),
+                  static_cast<std::uint32_t>(stream), 0} {}
+
+    // Uniform in [0, 1) with 52 random bits.
+    double uniform() {
+        if (used == 4) {
+            philox(counter, key, block);
+            ++counter[3];
+            used = 0;
+        }
+        const double value = toUniform(block[used], block[used + 1]);
+        used += 2;
+        return value;
+    }
+
+    // Same mapping as std::uniform_real_distribution.
+    double uniform(double min, double max) {
+        return min + (max - min) * uniform();
+    }
+
+    // Batched form for bulk initialization: for every index in
+    // [firstIndex, firstIndex + count) writes draws 2 * block and
+    // 2 * block + 1 of that index's sequence to first[] and second[].
+    // Uses the widest SIMD variant allowed by IntegrationKernel::activeIsa();
+    // all variants produce identical values.
+    static void uniformPairs(std::uint64_t seed, RngStream stream, std::uint64_t firstIndex, std::size_t count,
+                             std::uint32_t block, double* first, double* second);
+    // Same for the indices baseIndex + indices[j], j in [0, count).
+    static void uniformPairsAt(std::uint64_t seed, RngStream stream, std::uint64_t baseIndex, const std::uint32_t* indices,
+                               std::size_t count, std::uint32_t block, double* first, double* second);
+    // Four coarser draws per block for bulk resampling: each of the block's
+    // 32-bit words becomes a uniform in [0, 1) with 32 random bits, written
+    // to first[] .. fourth[].
+    static void uniformQuads(std::uint64_t seed, RngStream stream, std::uint64_t firstIndex, std::size_t count,
+                             std::uint32_t block, double* first, double* second, double* third, double* fourth);
+    static void uniformQuadsAt(std::uint64_t seed, RngStream stream, std::uint64_t baseIndex, const std::uint32_t* indices,
+                               std::size_t count, std::uint32_t block, double* first, double* second, double* third,
+                               double* fourth);
+
+    // Top 52 bits as the mantissa of a double in [1, 2), minus one.
+    static double toUniform(std::uint32_t high, std::uint32_t low) {
+        const std::uint64_t bits = ((static_cast<std::uint64_t>(high) << 32) | low) >> 12;
+        const std::uint64_t pattern = 0x3FF0000000000000ull | bits;
+        double value;
+        std::memcpy(&value, &pattern, sizeof(value));
+        return value - 1.0;
+    }
+
+    // A 32-bit word as the top of the mantissa of a double in [1, 2), minus one.
+    static double toUniform32(std::uint32_t word) {
+        const std::uint64_t pattern = 0x3FF0000000000000ull | (static_cast<std::uint64_t>(word) << 20);
+        double value;
+        std::memcpy(&value, &pattern, sizeof(value));
+        return value - 1.0;
+    }
+
+    static void philox(const std::uint32_t in[4], const std::uint32_t seedKey[2], std::uint32_t out[4]) {
+        std::uint32_t c0 = in[0], c1 = in[1], c2 = in[2], c3 = in[3];
+        std::uint32_t k0 = seedKey[0], k1 = seedKey[1];
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53u) * c0;
+            const std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57u) * c2;
+            c0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            c1 = static_cast<std::uint32_t>(p1);
+            c2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c3 = static_cast<std::uint32_t>(p0);
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+
+private:
+    std::uint32_t key[2];
+    std::uint32_t counter[4];
+    std::uint32_t block[4] = {0, 0, 0, 0};
+    int used = 4;
+};
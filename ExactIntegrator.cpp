@@ -0,0 +1,242 @@
+#include "ExactIntegrator.h"
+#include "Vector3D.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Regime changes are rare; the cap only guards against grazing contacts
+// bouncing between regimes on rounding noise.
+const int maxSegments = 16;
+const double boundaryTolerance = 1e-12;
+
+// (1 - e^-kt) / k, the velocity weight of (a - k v0).
+double phi1(double k, double t) {
+    return k > 0.0 ? -std::expm1(-k * t) / k : t;
+}
+
+// Integral of phi1 over [0, t], the position weight of (a - k v0).
+double phi2(double k, double t) {
+    const double x = k * t;
+    if (x < 1e-2) {
+        return t * t * (0.5 - x * (1.0 / 6.0 - x * (1.0 / 24.0 - x * (1.0 / 120.0 - x * (1.0 / 720.0 - x / 5040.0)))));
+    }
+    return (t - phi1(k, t)) / k;
+}
+
+double phi1Inverse(double k, double w) {
+    return k > 0.0 ? -std::log1p(-k * w) / k : w;
+}
+
+// Smallest root of qa w^2 + qb w + qc in (lower, upper].
+bool firstRoot(double qa, double qb, double qc, double lower, double upper, double& root) {
+    double roots[2];
+    int count = 0;
+    if (qa == 0.0) {
+        if (qb != 0.0) {
+            roots[count++] = -qc / qb;
+        }
+    } else {
+        const double discriminant = qb * qb - 4.0 * qa * qc;
+        if (discriminant < 0.0) {
+            return false;
+        }
+        // Numerically stable form: no cancellation between qb and the root.
+        const double q = -0.5 * (qb + std::copysign(std::sqrt(discriminant), qb));
+        roots[count++] = q / qa;
+        if (q != 0.0) {
+            roots[count++] = qc / q;
+        }
+    }
+
+    bool found = false;
+    for (int i = 0; i < count; ++i) {
+        if (roots[i] > lower && roots[i] <= upper && (!found || roots[i] < root)) {
+            root = roots[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+void advanceFree(Vector3D& x, Vector3D& v, const Vector3D& a, double k, double t) {
+    const Vector3D b = a - v * k;
+    x = x + v * t + b * phi2(k, t);
+    v = v + b * phi1(k, t);
+}
+
+struct Rotation {
+    Vector3D axis;
+    Vector3D normal;
+    double theta0 = 0.0;
+    double lambda = 0.0;
+    bool still = true;
+};
+
+// While |v| is held at `speed`, only the tangential part of a acts and v
+// turns towards a: d(theta)/dt = -(|a| / speed) sin(theta), which gives
+// tan(theta / 2) = tan(theta0 / 2) e^(-lambda t).
+Rotation rotationFor(const Vector3D& v, const Vector3D& a, double speed) {
+    Rotation r;
+    const double accel = a.magnitude();
+    if (accel == 0.0 || speed <= 0.0) {
+        return r;
+    }
+    r.axis = a * (1.0 / accel);
+    const Vector3D u = v * (1.0 / speed);
+    const double cosine = u.dot(r.axis);
+    const Vector3D perpendicular = u - r.axis * cosine;
+    const double sine = perpendicular.magnitude();
+    // Aligned with a, or exactly opposite (an unstable equilibrium).
+    if (sine < 1e-15) {
+        return r;
+    }
+    r.normal = perpendicular * (1.0 / sine);
+    r.theta0 = std::atan2(sine, cosine);
+    r.lambda = accel / speed;
+    r.still = false;
+    return r;
+}
+
+void advanceRotation(Vector3D& x, Vector3D& v, const Rotation& r, double speed, double t) {
+    if (r.still) {
+        x = x + v * t;
+        return;
+    }
+    const double tau0 = std::tan(0.5 * r.theta0);
+    const double tau = tau0 * std::exp(-r.lambda * t);
+    const double theta = 2.0 * std::atan(tau);
+    const double alongAxis = t + (std::log1p(tau * tau) - std::log1p(tau0 * tau0)) / r.lambda;
+    const double alongNormal = (r.theta0 - theta) / r.lambda;
+    x = x + (r.axis * alongAxis + r.normal * alongNormal) * speed;
+    v = (r.axis * std::cos(theta) + r.normal * std::sin(theta)) * speed;
+}
+
+// Time for a rotation to turn until a . u = threshold (threshold <= |a|).
+double rotationTimeTo(const Rotation& r, double cosine) {
+    const double theta = std::acos(std::min(1.0, std::max(-1.0, cosine)));
+    if (r.still || theta >= r.theta0) {
+        return 0.0;
+    }
+    return std::log(std::tan(0.5 * r.theta0) / std::tan(0.5 * theta)) / r.lambda;
+}
+
+void advancePoint(Vector3D& x, Vector3D& v, const Vector3D& a, double k, double vmin, double vmax, double duration) {
+    double remaining = duration;
+    // Set once a point has turned off the vmin sphere: radial speed is then
+    // zero up to rounding and |v| can only grow in the next free segment.
+    bool released = false;
+
+    for (int segment = 0; segment < maxSegments && remaining > 0.0; ++segment) {
+        // The clamp applies instantly, as in the substepped kernels.
+        double speed = v.magnitude();
+        if (speed > vmax) {
+            v = v * (vmax / speed);
+            speed = vmax;
+        } else if (speed < vmin && speed > 0.0) {
+            v = v * (vmin / speed);
+            speed = vmin;
+        } else if (speed == 0.0 && vmin > 0.0) {
+            const Vector3D push = a - v * k;
+            const double magnitude = push.magnitude();
+            if (magnitude > 0.0) {
+                v = push * (vmin / magnitude);
+                speed = vmin;
+            }
+        }
+
+        // Rate of change of |v| if the limits were not there.
+        const double radial = speed > 0.0 ? a.dot(v) / speed - k * speed : 0.0;
+        const bool atMax = speed >= vmax * (1.0 - boundaryTolerance);
+        const bool atMin = vmin > 0.0 && speed > 0.0 && speed <= vmin * (1.0 + boundaryTolerance);
+
+        if (atMax && radial > 0.0) {
+            // Pulled outwards: pinned to vmax for good, since turning
+            // towards a only strengthens the pull.
+            advanceRotation(x, v, rotationFor(v, a, vmax), vmax, remaining);
+            return;
+        }
+
+        if (atMin && radial < 0.0 && !released) {
+            // Held at vmin until a . u grows to k vmin.
+            const Rotation rotation = rotationFor(v, a, vmin);
+            const double accel = a.magnitude();
+            double t = remaining;
+            if (!rotation.still && accel > k * vmin) {
+                t = std::min(remaining, rotationTimeTo(rotation, k * vmin / accel));
+            }
+            released = true;
+            if (t > 0.0) {
+                advanceRotation(x, v, rotation, vmin, t);
+                v = v * (vmin / v.magnitude());
+                remaining -= t;
+                continue;
+            }
+        }
+
+        // Free motion: |v(w)|^2 is quadratic in w = phi1(t), so the next
+        // crossing of either limit has a closed form.
+        const Vector3D b = a - v * k;
+        const double qa = b.dot(b);
+        const double qb = 2.0 * v.dot(b);
+        const double v2 = v.dot(v);
+        const double span = phi1(k, remaining);
+        const double lower = span * boundaryTolerance;
+
+        double crossing = span;
+        double limit = 0.0;
+        double root;
+        if (firstRoot(qa, qb, v2 - vmax * vmax, lower, crossing, root)) {
+            crossing = root;
+            limit = vmax;
+        }
+        if (vmin > 0.0 && !released && firstRoot(qa, qb, v2 - vmin * vmin, lower, crossing, root)) {
+            crossing = root;
+            limit = vmin;
+        }
+
+        if (limit == 0.0) {
+            advanceFree(x, v, a, k, remaining);
+            return;
+        }
+
+        const double t = std::min(remaining, phi1Inverse(k, crossing));
+        advanceFree(x, v, a, k, t);
+        v = v * (limit / v.magnitude());
+        remaining -= t;
+        released = false;
+    }
+
+    if (remaining > 0.0) {
+        advanceFree(x, v, a, k, remaining);
+        const double speed = v.magnitude();
+        if (speed > vmax) {
+            v = v * (vmax / speed);
+        } else if (speed < vmin && speed > 0.0) {
+            v = v * (vmin / speed);
+        }
+    }
+}
+
+}
+
+template <typename Scalar>
+void ExactIntegrator::advance(BasicParticleStore<Scalar>& points, std::size_t begin, std::size_t end, double duration) {
+    const double vmin = points.limits.minVelocity;
+    const double vmax = points.limits.maxVelocity;
+
+    for (std::size_t i = begin; i < end; ++i) {
+        Vector3D x(points.position(i));
+        Vector3D v(points.velocity(i));
+        advancePoint(x, v, Vector3D(points.acceleration(i)), points.friction[i], vmin, vmax, duration);
+        points.px[i] = static_cast<Scalar>(x.x);
+        points.py[i] = static_cast<Scalar>(x.y);
+        points.pz[i] = static_cast<Scalar>(x.z);
+        points.vx[i] = static_cast<Scalar>(v.x);
+        points.vy[i] = static_cast<Scalar>(v.y);
+        points.vz[i] = static_cast<Scalar>(v.z);
+    }
+}
+
+template void ExactIntegrator::advance(ParticleStore&, std::size_t, std::size_t, double);
+template void ExactIntegrator::advance(FloatParticleStore&, std::size_t, std::size_t, double);
@@ -0,0 +1,20 @@
+#pragma once
+#include "ParticleStore.h"
+#include <cstddef>
+
+// Closed-form integration of dv/dt = a - k v with the speed held inside
+// [minVelocity, maxVelocity]. Between clamp events a point follows
+//
+//   v(t) = v0 + (a - k v0) (1 - e^-kt) / k
+//
+// and while its speed is pinned to a limit the velocity rotates towards a on
+// that sphere, which also has a closed form. A point is advanced segment by
+// segment, from one regime change to the next, so a whole output interval
+// usually costs one segment instead of 100 Euler substeps. This is the
+// dt -> 0 limit of the substepped kernels, without their drift. Float stores
+// are advanced in double and rounded once per call.
+class ExactIntegrator {
+public:
+    template <typename Scalar>
+    static void advance(BasicParticleStore<Scalar>& points, std::size_t begin, std::size_t end, double duration);
+};
@@ -0,0 +1,331 @@
+#include "IntegrationKernel.h"
+#include "IntegrationSchemes.h"
+#include "ExactIntegrator.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define POINTSIM_X86 1
+#include <cpuid.h>
+#endif
+
+namespace {
+
+template <typename T>
+struct ScalarLane {
+    static constexpr std::size_t width = 1;
+
+    static ScalarLane broadcast(double value) { return {static_cast<T>(value)}; }
+    static ScalarLane load(const T* p, std::size_t) { return {*p}; }
+    void store(T* p, std::size_t) const { *p = value; }
+
+    static ScalarLane min(const ScalarLane& a, const ScalarLane& b) { return {a.value < b.value ? a.value : b.value}; }
+    static ScalarLane max(const ScalarLane& a, const ScalarLane& b) { return {a.value > b.value ? a.value : b.value}; }
+    static ScalarLane select(const ScalarLane& x, const ScalarLane& y, const ScalarLane& a, const ScalarLane& b) {
+        return {x.value == y.value ? a.value : b.value};
+    }
+    static ScalarLane sqrt(const ScalarLane& a) { return {std::sqrt(a.value)}; }
+    static ScalarLane roundToFloat(const ScalarLane& a) { return {static_cast<T>(static_cast<float>(a.value))}; }
+
+    static void clamp(ScalarLane& vx, ScalarLane& vy, ScalarLane& vz, const ScalarLane& vmin, const ScalarLane& vmax) {
+        const T magnitude = std::sqrt(vx.value * vx.value + vy.value * vy.value + vz.value * vz.value);
+        const bool over = magnitude > vmax.value;
+        const bool under = magnitude < vmin.value && magnitude > 0;
+        if (over || under) {
+            const T scale = (over ? vmax.value : vmin.value) / magnitude;
+            vx.value = vx.value * scale;
+            vy.value = vy.value * scale;
+            vz.value = vz.value * scale;
+        }
+    }
+
+    T value;
+};
+
+template <typename T>
+ScalarLane<T> operator+(ScalarLane<T> a, ScalarLane<T> b) { return {a.value + b.value}; }
+template <typename T>
+ScalarLane<T> operator-(ScalarLane<T> a, ScalarLane<T> b) { return {a.value - b.value}; }
+template <typename T>
+ScalarLane<T> operator*(ScalarLane<T> a, ScalarLane<T> b) { return {a.value * b.value}; }
+template <typename T>
+ScalarLane<T> operator/(ScalarLane<T> a, ScalarLane<T> b) { return {a.value / b.value}; }
+
+}
+
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateScalar(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p) {
+    const LaneConstants<ScalarLane<Scalar>> constants(p);
+    for (std::size_t i = begin; i < end; ++i) {
+        integrateLanes<Scheme, Boundary>(a, i, 1, constants, p.steps);
+    }
+}
+
+POINTSIM_INSTANTIATE_KERNELS(integrateScalar)
+
+void sumForcesScalar(const ForceBatch& batch, std::size_t begin, std::size_t end) {
+    std::size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        sumForceLanes<ScalarLane<double>, 4>(batch, i, 4);
+    }
+    for (; i < end; ++i) {
+        sumForceLanes<ScalarLane<double>, 1>(batch, i, 1);
+    }
+}
+
+namespace {
+
+#ifdef POINTSIM_X86
+unsigned long long readXcr0() {
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+}
+#endif
+
+bool isaSupported(KernelIsa isa) {
+#ifdef POINTSIM_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return isa == KernelIsa::Scalar;
+    }
+    const bool sse2 = (edx & bit_SSE2) != 0;
+    const bool osxsave = (ecx & bit_OSXSAVE) != 0;
+    const bool avx = (ecx & bit_AVX) != 0;
+    const unsigned long long xcr0 = osxsave ? readXcr0() : 0;
+    const bool ymmState = (xcr0 & 0x6) == 0x6;
+    const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+    bool avx2 = false;
+    bool avx512f = false;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        avx2 = (ebx & bit_AVX2) != 0;
+        avx512f = (ebx & bit_AVX512F) != 0;
+    }
+
+    switch (isa) {
+        case KernelIsa::Scalar: return true;
+        case KernelIsa::SSE2: return sse2;
+        case KernelIsa::AVX2: return avx && avx2 && ymmState;
+        case KernelIsa::AVX512: return avx512f && zmmState;
+    }
+    return false;
+#else
+    return isa == KernelIsa::Scalar;
+#endif
+}
+
+template <typename Scalar>
+using KernelFunction = void (*)(const KernelArrays<Scalar>&, std::size_t, std::size_t, const KernelParams&);
+
+template <typename Scheme, typename Boundary, typename Scalar>
+KernelFunction<Scalar> kernelFor(KernelIsa isa) {
+    switch (isa) {
+#ifdef POINTSIM_X86
+        case KernelIsa::SSE2: return integrateSSE2<Scheme, Boundary, Scalar>;
+        case KernelIsa::AVX2: return integrateAVX2<Scheme, Boundary, Scalar>;
+        case KernelIsa::AVX512: return integrateAVX512<Scheme, Boundary, Scalar>;
+#endif
+        default: return integrateScalar<Scheme, Boundary, Scalar>;
+    }
+}
+
+template <typename Scheme, typename Scalar>
+KernelFunction<Scalar> kernelFor(KernelIsa isa, BoundaryMode boundary) {
+    switch (boundary) {
+        case BoundaryMode::Reflect: return kernelFor<Scheme, ReflectingBoundary, Scalar>(isa);
+        case BoundaryMode::Periodic: return kernelFor<Scheme, PeriodicBoundary, Scalar>(isa);
+        case BoundaryMode::Absorb: return kernelFor<Scheme, AbsorbingBoundary, Scalar>(isa);
+        default: return kernelFor<Scheme, OpenBoundary, Scalar>(isa);
+    }
+}
+
+// Position does not feed back into the motion, so the exact integrator can
+// wrap once at the end of the interval, however many periods it covered.
+template <typename Scalar>
+void wrapPositions(Scalar* p, std::size_t begin, std::size_t end, double lower, double size) {
+    for (std::size_t i = begin; i < end; ++i) {
+        p[i] = static_cast<Scalar>(p[i] - size * std::floor((p[i] - lower) / size));
+    }
+}
+
+std::atomic<KernelIsa>& selectedIsa() {
+    static std::atomic<KernelIsa> isa(IntegrationKernel::detectIsa());
+    return isa;
+}
+
+}
+
+KernelIsa IntegrationKernel::detectIsa() {
+    for (KernelIsa isa : {KernelIsa::AVX512, KernelIsa::AVX2, KernelIsa::SSE2}) {
+        if (isaSupported(isa)) {
+            return isa;
+        }
+    }
+    return KernelIsa::Scalar;
+}
+
+KernelIsa IntegrationKernel::activeIsa() {
+    return selectedIsa().load(std::memory_order_relaxed);
+}
+
+bool IntegrationKernel::selectIsa(KernelIsa isa) {
+    if (!isaSupported(isa)) {
+        return false;
+    }
+    selectedIsa().store(isa, std::memory_order_relaxed);
+    return true;
+}
+
+const char* IntegrationKernel::isaName(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::Scalar: return "scalar";
+        case KernelIsa::SSE2: return "sse2";
+        case KernelIsa::AVX2: return "avx2";
+        case KernelIsa::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool IntegrationKernel::parseIsa(const std::string& name, KernelIsa& isa) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    if (lower == "auto") {
+        isa = detectIsa();
+    } else if (lower == "scalar") {
+        isa = KernelIsa::Scalar;
+    } else if (lower == "sse2") {
+        isa = KernelIsa::SSE2;
+    } else if (lower == "avx2") {
+        isa = KernelIsa::AVX2;
+    } else if (lower == "avx512") {
+        isa = KernelIsa::AVX512;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* IntegrationKernel::schemeName(IntegrationScheme scheme) {
+    switch (scheme) {
+        case IntegrationScheme::Euler: return "euler";
+        case IntegrationScheme::SemiImplicit: return "semi_implicit";
+        case IntegrationScheme::Verlet: return "verlet";
+        case IntegrationScheme::RK4: return "rk4";
+        case IntegrationScheme::Exact: return "exact";
+    }
+    return "unknown";
+}
+
+bool IntegrationKernel::parseScheme(const std::string& name, IntegrationScheme& scheme) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    if (lower == "euler") {
+        scheme = IntegrationScheme::Euler;
+    } else if (lower == "semi_implicit") {
+        scheme = IntegrationScheme::SemiImplicit;
+    } else if (lower == "verlet") {
+        scheme = IntegrationScheme::Verlet;
+    } else if (lower == "rk4") {
+        scheme = IntegrationScheme::RK4;
+    } else if (lower == "exact") {
+        scheme = IntegrationScheme::Exact;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* IntegrationKernel::boundaryName(BoundaryMode boundary) {
+    switch (boundary) {
+        case BoundaryMode::None: return "none";
+        case BoundaryMode::Reflect: return "reflect";
+        case BoundaryMode::Periodic: return "periodic";
+        case BoundaryMode::Absorb: return "absorb";
+    }
+    return "unknown";
+}
+
+bool IntegrationKernel::parseBoundary(const std::string& name, BoundaryMode& boundary) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    if (lower == "none") {
+        boundary = BoundaryMode::None;
+    } else if (lower == "reflect") {
+        boundary = BoundaryMode::Reflect;
+    } else if (lower == "periodic") {
+        boundary = BoundaryMode::Periodic;
+    } else if (lower == "absorb") {
+        boundary = BoundaryMode::Absorb;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool IntegrationKernel::supportsBoundary(IntegrationScheme scheme, BoundaryMode boundary) {
+    return scheme != IntegrationScheme::Exact || boundary == BoundaryMode::None || boundary == BoundaryMode::Periodic;
+}
+
+template <typename Scalar>
+void IntegrationKernel::integrate(BasicParticleStore<Scalar>& points, std::size_t begin, std::size_t end, double dt, int steps,
+                                  IntegrationScheme scheme, const Walls& walls,
+                                  const BasicAccelerationField<Scalar>* acceleration) {
+    if (begin >= end || steps <= 0) {
+        return;
+    }
+    if (scheme == IntegrationScheme::Exact) {
+        ExactIntegrator::advance(points, begin, end, dt * steps);
+        if (walls.mode == BoundaryMode::Periodic) {
+            const double size = walls.upper - walls.lower;
+            wrapPositions(points.px.data(), begin, end, walls.lower, size);
+            wrapPositions(points.py.data(), begin, end, walls.lower, size);
+            wrapPositions(points.pz.data(), begin, end, walls.lower, size);
+        }
+        return;
+    }
+
+    const KernelArrays<Scalar> arrays = {
+        points.px.data(), points.py.data(), points.pz.data(),
+        points.vx.data(), points.vy.data(), points.vz.data(),
+        acceleration ? acceleration->x : points.ax.data(),
+        acceleration ? acceleration->y : points.ay.data(),
+        acceleration ? acceleration->z : points.az.data(),
+        points.friction.data()
+    };
+    const KernelParams params = {dt, points.limits.minVelocity, points.limits.maxVelocity, walls.lower, walls.upper, steps};
+
+    const KernelIsa isa = activeIsa();
+
+    switch (scheme) {
+        case IntegrationScheme::Euler: kernelFor<ExplicitEuler, Scalar>(isa, walls.mode)(arrays, begin, end, params); break;
+        case IntegrationScheme::Verlet: kernelFor<VelocityVerlet, Scalar>(isa, walls.mode)(arrays, begin, end, params); break;
+        case IntegrationScheme::RK4: kernelFor<RungeKutta4, Scalar>(isa, walls.mode)(arrays, begin, end, params); break;
+        default: kernelFor<SemiImplicitEuler, Scalar>(isa, walls.mode)(arrays, begin, end, params); break;
+    }
+}
+
+template void IntegrationKernel::integrate(ParticleStore&, std::size_t, std::size_t, double, int, IntegrationScheme,
+                                           const Walls&, const AccelerationField*);
+template void IntegrationKernel::integrate(FloatParticleStore&, std::size_t, std::size_t, double, int, IntegrationScheme,
+                                           const Walls&, const FloatAccelerationField*);
+
+void IntegrationKernel::sumForces(const double* forces, std::size_t numForces, const double* draws, std::size_t count,
+                                  double minAcceleration, double maxAcceleration, bool roundToFloat,
+                                  double* ax, double* ay, double* az) {
+    const ForceBatch batch = {
+        forces, numForces, draws, count, minAcceleration, maxAcceleration, roundToFloat, ax, ay, az
+    };
+    switch (activeIsa()) {
+#ifdef POINTSIM_X86
+        case KernelIsa::SSE2: sumForcesSSE2(batch, 0, count); break;
+        case KernelIsa::AVX2: sumForcesAVX2(batch, 0, count); break;
+        case KernelIsa::AVX512: sumForcesAVX512(batch, 0, count); break;
+#endif
+        default: sumForcesScalar(batch, 0, count); break;
+    }
+}
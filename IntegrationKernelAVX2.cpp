@@ -0,0 +1,192 @@
+#include "IntegrationSchemes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+namespace {
+
+struct AVX2Lane {
+    static constexpr std::size_t width = 4;
+
+    static AVX2Lane broadcast(double value) { return {_mm256_set1_pd(value)}; }
+    static AVX2Lane load(const double* p, std::size_t) { return {_mm256_loadu_pd(p)}; }
+    void store(double* p, std::size_t) const { _mm256_storeu_pd(p, value); }
+
+    static AVX2Lane min(const AVX2Lane& a, const AVX2Lane& b) { return {_mm256_min_pd(a.value, b.value)}; }
+    static AVX2Lane max(const AVX2Lane& a, const AVX2Lane& b) { return {_mm256_max_pd(a.value, b.value)}; }
+    static AVX2Lane select(const AVX2Lane& x, const AVX2Lane& y, const AVX2Lane& a, const AVX2Lane& b) {
+        return {_mm256_blendv_pd(b.value, a.value, _mm256_cmp_pd(x.value, y.value, _CMP_EQ_OQ))};
+    }
+    static AVX2Lane sqrt(const AVX2Lane& a) { return {_mm256_sqrt_pd(a.value)}; }
+    static AVX2Lane roundToFloat(const AVX2Lane& a) { return {_mm256_cvtps_pd(_mm256_cvtpd_ps(a.value))}; }
+
+    static void clamp(AVX2Lane& vx, AVX2Lane& vy, AVX2Lane& vz, const AVX2Lane& vmin, const AVX2Lane& vmax) {
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d magnitude = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vx.value, vx.value), _mm256_mul_pd(vy.value, vy.value)), _mm256_mul_pd(vz.value, vz.value)));
+        const __m256d over = _mm256_cmp_pd(magnitude, vmax.value, _CMP_GT_OQ);
+        const __m256d under = _mm256_and_pd(_mm256_cmp_pd(magnitude, vmin.value, _CMP_LT_OQ), _mm256_cmp_pd(magnitude, zero, _CMP_GT_OQ));
+        const __m256d limit = _mm256_blendv_pd(vmin.value, vmax.value, over);
+        const __m256d scale = _mm256_blendv_pd(one, _mm256_div_pd(limit, magnitude), _mm256_or_pd(over, under));
+        vx.value = _mm256_mul_pd(vx.value, scale);
+        vy.value = _mm256_mul_pd(vy.value, scale);
+        vz.value = _mm256_mul_pd(vz.value, scale);
+    }
+
+    __m256d value;
+};
+
+AVX2Lane operator+(AVX2Lane a, AVX2Lane b) { return {_mm256_add_pd(a.value, b.value)}; }
+AVX2Lane operator-(AVX2Lane a, AVX2Lane b) { return {_mm256_sub_pd(a.value, b.value)}; }
+AVX2Lane operator*(AVX2Lane a, AVX2Lane b) { return {_mm256_mul_pd(a.value, b.value)}; }
+AVX2Lane operator/(AVX2Lane a, AVX2Lane b) { return {_mm256_div_pd(a.value, b.value)}; }
+
+struct AVX2FloatLane {
+    static constexpr std::size_t width = 8;
+
+    static AVX2FloatLane broadcast(double value) { return {_mm256_set1_ps(static_cast<float>(value))}; }
+    static AVX2FloatLane load(const float* p, std::size_t) { return {_mm256_loadu_ps(p)}; }
+    void store(float* p, std::size_t) const { _mm256_storeu_ps(p, value); }
+
+    static AVX2FloatLane min(const AVX2FloatLane& a, const AVX2FloatLane& b) { return {_mm256_min_ps(a.value, b.value)}; }
+    static AVX2FloatLane max(const AVX2FloatLane& a, const AVX2FloatLane& b) { return {_mm256_max_ps(a.value, b.value)}; }
+    static AVX2FloatLane select(const AVX2FloatLane& x, const AVX2FloatLane& y, const AVX2FloatLane& a, const AVX2FloatLane& b) {
+        return {_mm256_blendv_ps(b.value, a.value, _mm256_cmp_ps(x.value, y.value, _CMP_EQ_OQ))};
+    }
+
+    static void clamp(AVX2FloatLane& vx, AVX2FloatLane& vy, AVX2FloatLane& vz, const AVX2FloatLane& vmin, const AVX2FloatLane& vmax) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 magnitude = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx.value, vx.value), _mm256_mul_ps(vy.value, vy.value)), _mm256_mul_ps(vz.value, vz.value)));
+        const __m256 over = _mm256_cmp_ps(magnitude, vmax.value, _CMP_GT_OQ);
+        const __m256 under = _mm256_and_ps(_mm256_cmp_ps(magnitude, vmin.value, _CMP_LT_OQ), _mm256_cmp_ps(magnitude, zero, _CMP_GT_OQ));
+        const __m256 limit = _mm256_blendv_ps(vmin.value, vmax.value, over);
+        const __m256 scale = _mm256_blendv_ps(one, _mm256_div_ps(limit, magnitude), _mm256_or_ps(over, under));
+        vx.value = _mm256_mul_ps(vx.value, scale);
+        vy.value = _mm256_mul_ps(vy.value, scale);
+        vz.value = _mm256_mul_ps(vz.value, scale);
+    }
+
+    __m256 value;
+};
+
+AVX2FloatLane operator+(AVX2FloatLane a, AVX2FloatLane b) { return {_mm256_add_ps(a.value, b.value)}; }
+AVX2FloatLane operator-(AVX2FloatLane a, AVX2FloatLane b) { return {_mm256_sub_ps(a.value, b.value)}; }
+AVX2FloatLane operator*(AVX2FloatLane a, AVX2FloatLane b) { return {_mm256_mul_ps(a.value, b.value)}; }
+
+}
+
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateAVX2(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p) {
+    using Lane = LaneFor<Scalar, AVX2Lane, AVX2FloatLane>;
+    const LaneConstants<Lane> constants(p);
+    std::size_t i = begin;
+    for (; i + Lane::width <= end; i += Lane::width) {
+        integrateLanes<Scheme, Boundary>(a, i, Lane::width, constants, p.steps);
+    }
+    integrateScalar<Scheme, Boundary>(a, i, end, p);
+}
+
+POINTSIM_INSTANTIATE_KERNELS(integrateAVX2)
+
+void sumForcesAVX2(const ForceBatch& batch, std::size_t begin, std::size_t end) {
+    std::size_t i = begin;
+    for (; i + 4 * AVX2Lane::width <= end; i += 4 * AVX2Lane::width) {
+        sumForceLanes<AVX2Lane, 4>(batch, i, 4 * AVX2Lane::width);
+    }
+    for (; i + AVX2Lane::width <= end; i += AVX2Lane::width) {
+        sumForceLanes<AVX2Lane, 1>(batch, i, AVX2Lane::width);
+    }
+    sumForcesScalar(batch, i, end);
+}
+
+namespace {
+
+// Philox4x32-10 on four counters at once. Each 64-bit lane holds one 32-bit
+// word in its low half, which is what _mm256_mul_epu32 multiplies.
+__m256i philoxWord(__m256i value) {
+    return _mm256_and_si256(value, _mm256_set1_epi64x(0xFFFFFFFFll));
+}
+
+// One 32-bit word (low half of each lane) as a uniform in [0, 1).
+__m256d philoxUniform32(__m256i word) {
+    const __m256i pattern = _mm256_or_si256(_mm256_slli_epi64(philoxWord(word), 20), _mm256_set1_epi64x(0x3FF0000000000000ll));
+    return _mm256_sub_pd(_mm256_castsi256_pd(pattern), _mm256_set1_pd(1.0));
+}
+
+__m256d philoxUniform(__m256i high, __m256i low) {
+    const __m256i bits = _mm256_srli_epi64(_mm256_or_si256(_mm256_slli_epi64(high, 32), low), 12);
+    const __m256i pattern = _mm256_or_si256(bits, _mm256_set1_epi64x(0x3FF0000000000000ll));
+    return _mm256_sub_pd(_mm256_castsi256_pd(pattern), _mm256_set1_pd(1.0));
+}
+
+}
+
+void uniformPairsAVX2(const RandomBatch& batch) {
+    const __m256i m0 = _mm256_set1_epi64x(0xD2511F53ll);
+    const __m256i m1 = _mm256_set1_epi64x(0xCD9E8D57ll);
+    const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+
+    for (std::size_t j = 0; j < batch.count; j += 4) {
+        __m256i offsets = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(j)), lanes);
+        if (batch.indices) {
+            alignas(16) std::uint32_t indexLanes[4] = {0, 0, 0, 0};
+            for (std::size_t l = 0; l < 4 && j + l < batch.count; ++l) {
+                indexLanes[l] = batch.indices[j + l];
+            }
+            offsets = _mm256_cvtepu32_epi64(_mm_load_si128(reinterpret_cast<const __m128i*>(indexLanes)));
+        }
+        const __m256i index = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(batch.firstIndex)), offsets);
+        __m256i c0 = philoxWord(index);
+        __m256i c1 = _mm256_srli_epi64(index, 32);
+        __m256i c2 = _mm256_set1_epi64x(batch.stream);
+        __m256i c3 = _mm256_set1_epi64x(batch.block);
+        std::uint32_t k0 = batch.key[0];
+        std::uint32_t k1 = batch.key[1];
+
+        for (int round = 0; round < 10; ++round) {
+            const __m256i p0 = _mm256_mul_epu32(c0, m0);
+            const __m256i p1 = _mm256_mul_epu32(c2, m1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), _mm256_set1_epi64x(k0));
+            c1 = philoxWord(p1);
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), _mm256_set1_epi64x(k1));
+            c3 = philoxWord(p0);
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+
+        if (batch.third) {
+            const __m256d words[4] = {philoxUniform32(c0), philoxUniform32(c1), philoxUniform32(c2), philoxUniform32(c3)};
+            double* outputs[4] = {batch.first, batch.second, batch.third, batch.fourth};
+            for (int w = 0; w < 4; ++w) {
+                if (batch.count - j >= 4) {
+                    _mm256_storeu_pd(outputs[w] + j, words[w]);
+                } else {
+                    alignas(32) double wordLanes[4];
+                    _mm256_store_pd(wordLanes, words[w]);
+                    for (std::size_t l = 0; l < batch.count - j; ++l) {
+                        outputs[w][j + l] = wordLanes[l];
+                    }
+                }
+            }
+            continue;
+        }
+        const __m256d first = philoxUniform(c0, c1);
+        const __m256d second = philoxUniform(c2, c3);
+        if (batch.count - j >= 4) {
+            _mm256_storeu_pd(batch.first + j, first);
+            _mm256_storeu_pd(batch.second + j, second);
+        } else {
+            alignas(32) double firstLanes[4];
+            alignas(32) double secondLanes[4];
+            _mm256_store_pd(firstLanes, first);
+            _mm256_store_pd(secondLanes, second);
+            for (std::size_t l = 0; l < batch.count - j; ++l) {
+                batch.first[j + l] = firstLanes[l];
+                batch.second[j + l] = secondLanes[l];
+            }
+        }
+    }
+}
+
+#endif
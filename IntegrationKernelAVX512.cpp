@@ -0,0 +1,193 @@
+#include "IntegrationSchemes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(__GNUC__) && !defined(__clang__)
+// _mm512_sqrt_pd starts from _mm512_undefined_pd(), which GCC reports as a
+// maybe-uninitialized read once inlined.
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace {
+
+// The tail is handled with a partial lane mask instead of a scalar loop.
+__mmask8 laneMask(std::size_t count) {
+    return count >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << count) - 1);
+}
+
+struct AVX512Lane {
+    static constexpr std::size_t width = 8;
+
+    static AVX512Lane broadcast(double value) { return {_mm512_set1_pd(value)}; }
+    static AVX512Lane load(const double* p, std::size_t count) { return {_mm512_maskz_loadu_pd(laneMask(count), p)}; }
+    void store(double* p, std::size_t count) const { _mm512_mask_storeu_pd(p, laneMask(count), value); }
+
+    static AVX512Lane min(const AVX512Lane& a, const AVX512Lane& b) { return {_mm512_min_pd(a.value, b.value)}; }
+    static AVX512Lane max(const AVX512Lane& a, const AVX512Lane& b) { return {_mm512_max_pd(a.value, b.value)}; }
+    static AVX512Lane select(const AVX512Lane& x, const AVX512Lane& y, const AVX512Lane& a, const AVX512Lane& b) {
+        return {_mm512_mask_blend_pd(_mm512_cmp_pd_mask(x.value, y.value, _CMP_EQ_OQ), b.value, a.value)};
+    }
+    static AVX512Lane sqrt(const AVX512Lane& a) { return {_mm512_sqrt_pd(a.value)}; }
+    static AVX512Lane roundToFloat(const AVX512Lane& a) { return {_mm512_cvtps_pd(_mm512_cvtpd_ps(a.value))}; }
+
+    static void clamp(AVX512Lane& vx, AVX512Lane& vy, AVX512Lane& vz, const AVX512Lane& vmin, const AVX512Lane& vmax) {
+        const __m512d zero = _mm512_setzero_pd();
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d magnitude = _mm512_sqrt_pd(_mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(vx.value, vx.value), _mm512_mul_pd(vy.value, vy.value)), _mm512_mul_pd(vz.value, vz.value)));
+        const __mmask8 over = _mm512_cmp_pd_mask(magnitude, vmax.value, _CMP_GT_OQ);
+        const __mmask8 under = _mm512_cmp_pd_mask(magnitude, vmin.value, _CMP_LT_OQ) & _mm512_cmp_pd_mask(magnitude, zero, _CMP_GT_OQ);
+        const __m512d limit = _mm512_mask_blend_pd(over, vmin.value, vmax.value);
+        const __m512d scale = _mm512_mask_div_pd(one, over | under, limit, magnitude);
+        vx.value = _mm512_mul_pd(vx.value, scale);
+        vy.value = _mm512_mul_pd(vy.value, scale);
+        vz.value = _mm512_mul_pd(vz.value, scale);
+    }
+
+    __m512d value;
+};
+
+AVX512Lane operator+(AVX512Lane a, AVX512Lane b) { return {_mm512_add_pd(a.value, b.value)}; }
+AVX512Lane operator-(AVX512Lane a, AVX512Lane b) { return {_mm512_sub_pd(a.value, b.value)}; }
+AVX512Lane operator*(AVX512Lane a, AVX512Lane b) { return {_mm512_mul_pd(a.value, b.value)}; }
+AVX512Lane operator/(AVX512Lane a, AVX512Lane b) { return {_mm512_div_pd(a.value, b.value)}; }
+
+__mmask16 floatLaneMask(std::size_t count) {
+    return count >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << count) - 1);
+}
+
+struct AVX512FloatLane {
+    static constexpr std::size_t width = 16;
+
+    static AVX512FloatLane broadcast(double value) { return {_mm512_set1_ps(static_cast<float>(value))}; }
+    static AVX512FloatLane load(const float* p, std::size_t count) { return {_mm512_maskz_loadu_ps(floatLaneMask(count), p)}; }
+    void store(float* p, std::size_t count) const { _mm512_mask_storeu_ps(p, floatLaneMask(count), value); }
+
+    static AVX512FloatLane min(const AVX512FloatLane& a, const AVX512FloatLane& b) { return {_mm512_min_ps(a.value, b.value)}; }
+    static AVX512FloatLane max(const AVX512FloatLane& a, const AVX512FloatLane& b) { return {_mm512_max_ps(a.value, b.value)}; }
+    static AVX512FloatLane select(const AVX512FloatLane& x, const AVX512FloatLane& y, const AVX512FloatLane& a, const AVX512FloatLane& b) {
+        return {_mm512_mask_blend_ps(_mm512_cmp_ps_mask(x.value, y.value, _CMP_EQ_OQ), b.value, a.value)};
+    }
+
+    static void clamp(AVX512FloatLane& vx, AVX512FloatLane& vy, AVX512FloatLane& vz, const AVX512FloatLane& vmin, const AVX512FloatLane& vmax) {
+        const __m512 zero = _mm512_setzero_ps();
+        const __m512 one = _mm512_set1_ps(1.0f);
+        const __m512 magnitude = _mm512_sqrt_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(vx.value, vx.value), _mm512_mul_ps(vy.value, vy.value)), _mm512_mul_ps(vz.value, vz.value)));
+        const __mmask16 over = _mm512_cmp_ps_mask(magnitude, vmax.value, _CMP_GT_OQ);
+        const __mmask16 under = _mm512_cmp_ps_mask(magnitude, vmin.value, _CMP_LT_OQ) & _mm512_cmp_ps_mask(magnitude, zero, _CMP_GT_OQ);
+        const __m512 limit = _mm512_mask_blend_ps(over, vmin.value, vmax.value);
+        const __m512 scale = _mm512_mask_div_ps(one, over | under, limit, magnitude);
+        vx.value = _mm512_mul_ps(vx.value, scale);
+        vy.value = _mm512_mul_ps(vy.value, scale);
+        vz.value = _mm512_mul_ps(vz.value, scale);
+    }
+
+    __m512 value;
+};
+
+AVX512FloatLane operator+(AVX512FloatLane a, AVX512FloatLane b) { return {_mm512_add_ps(a.value, b.value)}; }
+AVX512FloatLane operator-(AVX512FloatLane a, AVX512FloatLane b) { return {_mm512_sub_ps(a.value, b.value)}; }
+AVX512FloatLane operator*(AVX512FloatLane a, AVX512FloatLane b) { return {_mm512_mul_ps(a.value, b.value)}; }
+
+}
+
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateAVX512(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p) {
+    using Lane = LaneFor<Scalar, AVX512Lane, AVX512FloatLane>;
+    const LaneConstants<Lane> constants(p);
+    for (std::size_t i = begin; i < end; i += Lane::width) {
+        const std::size_t remaining = end - i;
+        integrateLanes<Scheme, Boundary>(a, i, remaining < Lane::width ? remaining : Lane::width, constants, p.steps);
+    }
+}
+
+POINTSIM_INSTANTIATE_KERNELS(integrateAVX512)
+
+void sumForcesAVX512(const ForceBatch& batch, std::size_t begin, std::size_t end) {
+    // The tail lanes are masked, so every call takes up to four groups.
+    for (std::size_t i = begin; i < end; i += 4 * AVX512Lane::width) {
+        const std::size_t remaining = end - i;
+        sumForceLanes<AVX512Lane, 4>(batch, i, remaining < 4 * AVX512Lane::width ? remaining : 4 * AVX512Lane::width);
+    }
+}
+
+namespace {
+
+// Philox4x32-10 on eight counters at once; see uniformPairsAVX2.
+__m512i philoxWord(__m512i value) {
+    return _mm512_and_si512(value, _mm512_set1_epi64(0xFFFFFFFFll));
+}
+
+// One 32-bit word (low half of each lane) as a uniform in [0, 1).
+__m512d philoxUniform32(__m512i word) {
+    const __m512i pattern = _mm512_or_si512(_mm512_slli_epi64(philoxWord(word), 20), _mm512_set1_epi64(0x3FF0000000000000ll));
+    return _mm512_sub_pd(_mm512_castsi512_pd(pattern), _mm512_set1_pd(1.0));
+}
+
+__m512d philoxUniform(__m512i high, __m512i low) {
+    const __m512i bits = _mm512_srli_epi64(_mm512_or_si512(_mm512_slli_epi64(high, 32), low), 12);
+    const __m512i pattern = _mm512_or_si512(bits, _mm512_set1_epi64(0x3FF0000000000000ll));
+    return _mm512_sub_pd(_mm512_castsi512_pd(pattern), _mm512_set1_pd(1.0));
+}
+
+}
+
+void uniformPairsAVX512(const RandomBatch& batch) {
+    const __m512i m0 = _mm512_set1_epi64(0xD2511F53ll);
+    const __m512i m1 = _mm512_set1_epi64(0xCD9E8D57ll);
+    const __m512i lanes = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    // Independent counter vectors in flight per round; one alone is bound by
+    // the multiply latency.
+    const int ways = 4;
+
+    for (std::size_t j = 0; j < batch.count; j += 8 * ways) {
+        __mmask8 valid[ways];
+        __m512i c0[ways], c1[ways], c2[ways], c3[ways];
+        for (int w = 0; w < ways; ++w) {
+            const std::size_t at = j + 8 * w;
+            const std::size_t remaining = at < batch.count ? batch.count - at : 0;
+            valid[w] = remaining >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << remaining) - 1);
+            const __m512i offsets = batch.indices
+                ? _mm512_cvtepu32_epi64(_mm512_castsi512_si256(_mm512_maskz_loadu_epi32(valid[w], batch.indices + at)))
+                : _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(at)), lanes);
+            const __m512i index = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(batch.firstIndex)), offsets);
+            c0[w] = philoxWord(index);
+            c1[w] = _mm512_srli_epi64(index, 32);
+            c2[w] = _mm512_set1_epi64(batch.stream);
+            c3[w] = _mm512_set1_epi64(batch.block);
+        }
+        std::uint32_t k0 = batch.key[0];
+        std::uint32_t k1 = batch.key[1];
+
+        for (int round = 0; round < 10; ++round) {
+            for (int w = 0; w < ways; ++w) {
+                const __m512i p0 = _mm512_mul_epu32(c0[w], m0);
+                const __m512i p1 = _mm512_mul_epu32(c2[w], m1);
+                // The products' high halves stay in c1 and c3 until the end:
+                // the multiplies only read the low 32 bits of each lane.
+                c0[w] = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1[w]), _mm512_set1_epi64(k0));
+                c1[w] = p1;
+                c2[w] = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3[w]), _mm512_set1_epi64(k1));
+                c3[w] = p0;
+            }
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+
+        if (batch.third) {
+            for (int w = 0; w < ways; ++w) {
+                _mm512_mask_storeu_pd(batch.first + j + 8 * w, valid[w], philoxUniform32(c0[w]));
+                _mm512_mask_storeu_pd(batch.second + j + 8 * w, valid[w], philoxUniform32(c1[w]));
+                _mm512_mask_storeu_pd(batch.third + j + 8 * w, valid[w], philoxUniform32(c2[w]));
+                _mm512_mask_storeu_pd(batch.fourth + j + 8 * w, valid[w], philoxUniform32(c3[w]));
+            }
+            continue;
+        }
+        for (int w = 0; w < ways; ++w) {
+            _mm512_mask_storeu_pd(batch.first + j + 8 * w, valid[w], philoxUniform(c0[w], philoxWord(c1[w])));
+            _mm512_mask_storeu_pd(batch.second + j + 8 * w, valid[w], philoxUniform(c2[w], philoxWord(c3[w])));
+        }
+    }
+}
+
+#endif
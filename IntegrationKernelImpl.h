@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Raw-pointer view of a ParticleStore handed to the per-ISA kernels. The ISA
+// translation units are compiled with extra -m flags, so they must not
+// instantiate any inline code (std::vector, Vector3D, ...) that the linker
+// could merge into the baseline build.
+template <typename Scalar>
+struct KernelArrays {
+    Scalar* px;
+    Scalar* py;
+    Scalar* pz;
+    Scalar* vx;
+    Scalar* vy;
+    Scalar* vz;
+    const Scalar* ax;
+    const Scalar* ay;
+    const Scalar* az;
+    const Scalar* friction;
+};
+
+struct KernelParams {
+    double dt;
+    double minVelocity;
+    double maxVelocity;
+    double lower;
+    double upper;
+    int steps;
+};
+
+// Scheme and boundary policies, defined in IntegrationSchemes.h. Every kernel
+// below is explicitly instantiated for each pair and for double and float
+// arrays in its ISA's translation unit.
+struct ExplicitEuler;
+struct SemiImplicitEuler;
+struct VelocityVerlet;
+struct RungeKutta4;
+
+struct OpenBoundary;
+struct ReflectingBoundary;
+struct PeriodicBoundary;
+struct AbsorbingBoundary;
+
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateScalar(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p);
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateSSE2(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p);
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateAVX2(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p);
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateAVX512(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p);
+
+// Batched Philox4x32-10 for CounterRng::uniformPairs and uniformQuads; same
+// layout rules as the integration kernels.
+struct RandomBatch {
+    std::uint32_t key[2];
+    std::uint32_t stream;
+    std::uint32_t block;
+    std::uint64_t firstIndex;
+    // When set, the j-th index is firstIndex + indices[j] instead of firstIndex + j.
+    const std::uint32_t* indices;
+    std::size_t count;
+    double* first;
+    double* second;
+    // When set, all four words are written as 32-bit uniforms instead
+    // (CounterRng::uniformQuads).
+    double* third;
+    double* fourth;
+};
+
+void uniformPairsScalar(const RandomBatch& batch);
+void uniformPairsAVX2(const RandomBatch& batch);
+void uniformPairsAVX512(const RandomBatch& batch);
+
+// Per-step force sums for IntegrationKernel::sumForces; same layout rules as
+// the integration kernels.
+struct ForceBatch {
+    // Five doubles per force: direction x, y, z, minimum magnitude and range.
+    const double* forces;
+    std::size_t numForces;
+    // draws[f * count + j] is force f's draw in [0, 1) for point j.
+    const double* draws;
+    std::size_t count;
+    double minAcceleration;
+    double maxAcceleration;
+    // Round the running sum to float after every second force.
+    bool roundToFloat;
+    double* ax;
+    double* ay;
+    double* az;
+};
+
+void sumForcesScalar(const ForceBatch& batch, std::size_t begin, std::size_t end);
+void sumForcesSSE2(const ForceBatch& batch, std::size_t begin, std::size_t end);
+void sumForcesAVX2(const ForceBatch& batch, std::size_t begin, std::size_t end);
+void sumForcesAVX512(const ForceBatch& batch, std::size_t begin, std::size_t end);
@@ -0,0 +1,107 @@
+#include "IntegrationSchemes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+
+namespace {
+
+struct SSE2Lane {
+    static constexpr std::size_t width = 2;
+
+    static SSE2Lane broadcast(double value) { return {_mm_set1_pd(value)}; }
+    static SSE2Lane load(const double* p, std::size_t) { return {_mm_loadu_pd(p)}; }
+    void store(double* p, std::size_t) const { _mm_storeu_pd(p, value); }
+
+    static SSE2Lane min(const SSE2Lane& a, const SSE2Lane& b) { return {_mm_min_pd(a.value, b.value)}; }
+    static SSE2Lane max(const SSE2Lane& a, const SSE2Lane& b) { return {_mm_max_pd(a.value, b.value)}; }
+    static SSE2Lane select(const SSE2Lane& x, const SSE2Lane& y, const SSE2Lane& a, const SSE2Lane& b) {
+        const __m128d equal = _mm_cmpeq_pd(x.value, y.value);
+        return {_mm_or_pd(_mm_and_pd(equal, a.value), _mm_andnot_pd(equal, b.value))};
+    }
+    static SSE2Lane sqrt(const SSE2Lane& a) { return {_mm_sqrt_pd(a.value)}; }
+    static SSE2Lane roundToFloat(const SSE2Lane& a) { return {_mm_cvtps_pd(_mm_cvtpd_ps(a.value))}; }
+
+    static void clamp(SSE2Lane& vx, SSE2Lane& vy, SSE2Lane& vz, const SSE2Lane& vmin, const SSE2Lane& vmax) {
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d one = _mm_set1_pd(1.0);
+        const __m128d magnitude = _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(vx.value, vx.value), _mm_mul_pd(vy.value, vy.value)), _mm_mul_pd(vz.value, vz.value)));
+        const __m128d over = _mm_cmpgt_pd(magnitude, vmax.value);
+        const __m128d under = _mm_and_pd(_mm_cmplt_pd(magnitude, vmin.value), _mm_cmpgt_pd(magnitude, zero));
+        const __m128d limit = _mm_or_pd(_mm_and_pd(over, vmax.value), _mm_andnot_pd(over, vmin.value));
+        const __m128d clamped = _mm_or_pd(over, under);
+        const __m128d scale = _mm_or_pd(_mm_and_pd(clamped, _mm_div_pd(limit, magnitude)), _mm_andnot_pd(clamped, one));
+        vx.value = _mm_mul_pd(vx.value, scale);
+        vy.value = _mm_mul_pd(vy.value, scale);
+        vz.value = _mm_mul_pd(vz.value, scale);
+    }
+
+    __m128d value;
+};
+
+SSE2Lane operator+(SSE2Lane a, SSE2Lane b) { return {_mm_add_pd(a.value, b.value)}; }
+SSE2Lane operator-(SSE2Lane a, SSE2Lane b) { return {_mm_sub_pd(a.value, b.value)}; }
+SSE2Lane operator*(SSE2Lane a, SSE2Lane b) { return {_mm_mul_pd(a.value, b.value)}; }
+SSE2Lane operator/(SSE2Lane a, SSE2Lane b) { return {_mm_div_pd(a.value, b.value)}; }
+
+struct SSE2FloatLane {
+    static constexpr std::size_t width = 4;
+
+    static SSE2FloatLane broadcast(double value) { return {_mm_set1_ps(static_cast<float>(value))}; }
+    static SSE2FloatLane load(const float* p, std::size_t) { return {_mm_loadu_ps(p)}; }
+    void store(float* p, std::size_t) const { _mm_storeu_ps(p, value); }
+
+    static SSE2FloatLane min(const SSE2FloatLane& a, const SSE2FloatLane& b) { return {_mm_min_ps(a.value, b.value)}; }
+    static SSE2FloatLane max(const SSE2FloatLane& a, const SSE2FloatLane& b) { return {_mm_max_ps(a.value, b.value)}; }
+    static SSE2FloatLane select(const SSE2FloatLane& x, const SSE2FloatLane& y, const SSE2FloatLane& a, const SSE2FloatLane& b) {
+        const __m128 equal = _mm_cmpeq_ps(x.value, y.value);
+        return {_mm_or_ps(_mm_and_ps(equal, a.value), _mm_andnot_ps(equal, b.value))};
+    }
+
+    static void clamp(SSE2FloatLane& vx, SSE2FloatLane& vy, SSE2FloatLane& vz, const SSE2FloatLane& vmin, const SSE2FloatLane& vmax) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx.value, vx.value), _mm_mul_ps(vy.value, vy.value)), _mm_mul_ps(vz.value, vz.value)));
+        const __m128 over = _mm_cmpgt_ps(magnitude, vmax.value);
+        const __m128 under = _mm_and_ps(_mm_cmplt_ps(magnitude, vmin.value), _mm_cmpgt_ps(magnitude, zero));
+        const __m128 limit = _mm_or_ps(_mm_and_ps(over, vmax.value), _mm_andnot_ps(over, vmin.value));
+        const __m128 clamped = _mm_or_ps(over, under);
+        const __m128 scale = _mm_or_ps(_mm_and_ps(clamped, _mm_div_ps(limit, magnitude)), _mm_andnot_ps(clamped, one));
+        vx.value = _mm_mul_ps(vx.value, scale);
+        vy.value = _mm_mul_ps(vy.value, scale);
+        vz.value = _mm_mul_ps(vz.value, scale);
+    }
+
+    __m128 value;
+};
+
+SSE2FloatLane operator+(SSE2FloatLane a, SSE2FloatLane b) { return {_mm_add_ps(a.value, b.value)}; }
+SSE2FloatLane operator-(SSE2FloatLane a, SSE2FloatLane b) { return {_mm_sub_ps(a.value, b.value)}; }
+SSE2FloatLane operator*(SSE2FloatLane a, SSE2FloatLane b) { return {_mm_mul_ps(a.value, b.value)}; }
+
+}
+
+template <typename Scheme, typename Boundary, typename Scalar>
+void integrateSSE2(const KernelArrays<Scalar>& a, std::size_t begin, std::size_t end, const KernelParams& p) {
+    using Lane = LaneFor<Scalar, SSE2Lane, SSE2FloatLane>;
+    const LaneConstants<Lane> constants(p);
+    std::size_t i = begin;
+    for (; i + Lane::width <= end; i += Lane::width) {
+        integrateLanes<Scheme, Boundary>(a, i, Lane::width, constants, p.steps);
+    }
+    integrateScalar<Scheme, Boundary>(a, i, end, p);
+}
+
+POINTSIM_INSTANTIATE_KERNELS(integrateSSE2)
+
+void sumForcesSSE2(const ForceBatch& batch, std::size_t begin, std::size_t end) {
+    std::size_t i = begin;
+    for (; i + 4 * SSE2Lane::width <= end; i += 4 * SSE2Lane::width) {
+        sumForceLanes<SSE2Lane, 4>(batch, i, 4 * SSE2Lane::width);
+    }
+    for (; i + SSE2Lane::width <= end; i += SSE2Lane::width) {
+        sumForceLanes<SSE2Lane, 1>(batch, i, SSE2Lane::width);
+    }
+    sumForcesScalar(batch, i, end);
+}
+
+#endif
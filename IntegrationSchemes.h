@@ -0,0 +1,303 @@
+#pragma once
+#include "IntegrationKernelImpl.h"
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+// Time-stepping schemes for dv/dt = a - k v, dx/dt = v with the speed clamped
+// to [minVelocity, maxVelocity] after every step. Each scheme is a policy
+// whose step() is written once against a lane type: a plain double or float
+// in IntegrationKernel.cpp, one SIMD register per ISA translation unit. The
+// scheme is a template argument, so the step loop is compiled separately for
+// each scheme, ISA and scalar type and never branches on the scheme.
+//
+// A lane type provides width, broadcast(), load(), store(), +, -, *, static
+// min(), max(), select(x, y, a, b) (x == y ? a : b per lane, with min/max
+// returning the second operand on NaN like minpd/maxpd) and a static
+// clamp(vx, vy, vz, vmin, vmax). broadcast() takes a double and rounds it to
+// the lane's scalar type. Double lanes also provide /, static sqrt() and
+// roundToFloat() for sumForceLanes. Lane types live in anonymous namespaces,
+// which keeps every instantiation local to its ISA's object file.
+
+// An ISA's lane type for arrays of Scalar.
+template <typename Scalar, typename DoubleLane, typename FloatLane>
+using LaneFor = typename std::conditional<std::is_same<Scalar, float>::value, FloatLane, DoubleLane>::type;
+
+template <typename Lane>
+struct LaneState {
+    Lane px, py, pz;
+    Lane vx, vy, vz;
+};
+
+template <typename Lane>
+struct LaneForce {
+    Lane ax, ay, az;
+    Lane k;
+};
+
+template <typename Lane>
+struct LaneConstants {
+    explicit LaneConstants(const KernelParams& p)
+        : dt(Lane::broadcast(p.dt)), halfDt(Lane::broadcast(0.5 * p.dt)), sixthDt(Lane::broadcast(p.dt / 6.0)),
+          two(Lane::broadcast(2.0)), vmin(Lane::broadcast(p.minVelocity)), vmax(Lane::broadcast(p.maxVelocity)),
+          zero(Lane::broadcast(0.0)), lower(Lane::broadcast(p.lower)), upper(Lane::broadcast(p.upper)),
+          size(Lane::broadcast(p.upper - p.lower)), negativeSize(Lane::broadcast(p.lower - p.upper)),
+          absorbed(Lane::broadcast(std::numeric_limits<double>::quiet_NaN())) {}
+
+    Lane dt, halfDt, sixthDt, two;
+    Lane vmin, vmax;
+    Lane zero, lower, upper, size, negativeSize, absorbed;
+};
+
+// x += v dt, then v += (a - k v) dt.
+struct ExplicitEuler {
+    template <typename Lane>
+    static void step(LaneState<Lane>& s, const LaneForce<Lane>& f, const LaneConstants<Lane>& c) {
+        s.px = s.px + s.vx * c.dt;
+        s.py = s.py + s.vy * c.dt;
+        s.pz = s.pz + s.vz * c.dt;
+        s.vx = s.vx + (f.ax - s.vx * f.k) * c.dt;
+        s.vy = s.vy + (f.ay - s.vy * f.k) * c.dt;
+        s.vz = s.vz + (f.az - s.vz * f.k) * c.dt;
+        Lane::clamp(s.vx, s.vy, s.vz, c.vmin, c.vmax);
+    }
+};
+
+// v += (a - k v) dt, then x moves with the new, clamped v. The operation
+// order is the one the simulator has always used.
+struct SemiImplicitEuler {
+    template <typename Lane>
+    static void step(LaneState<Lane>& s, const LaneForce<Lane>& f, const LaneConstants<Lane>& c) {
+        s.vx = s.vx + (f.ax - s.vx * f.k) * c.dt;
+        s.vy = s.vy + (f.ay - s.vy * f.k) * c.dt;
+        s.vz = s.vz + (f.az - s.vz * f.k) * c.dt;
+        Lane::clamp(s.vx, s.vy, s.vz, c.vmin, c.vmax);
+        s.px = s.px + s.vx * c.dt;
+        s.py = s.py + s.vy * c.dt;
+        s.pz = s.pz + s.vz * c.dt;
+    }
+};
+
+// Velocity Verlet. The acceleration depends on v, so the end-of-step
+// acceleration is evaluated at the predicted velocity v + (a - k v) dt.
+struct VelocityVerlet {
+    template <typename Lane>
+    static void step(LaneState<Lane>& s, const LaneForce<Lane>& f, const LaneConstants<Lane>& c) {
+        const Lane gx = f.ax - s.vx * f.k;
+        const Lane gy = f.ay - s.vy * f.k;
+        const Lane gz = f.az - s.vz * f.k;
+        s.px = s.px + (s.vx + gx * c.halfDt) * c.dt;
+        s.py = s.py + (s.vy + gy * c.halfDt) * c.dt;
+        s.pz = s.pz + (s.vz + gz * c.halfDt) * c.dt;
+        const Lane ex = f.ax - (s.vx + gx * c.dt) * f.k;
+        const Lane ey = f.ay - (s.vy + gy * c.dt) * f.k;
+        const Lane ez = f.az - (s.vz + gz * c.dt) * f.k;
+        s.vx = s.vx + (gx + ex) * c.halfDt;
+        s.vy = s.vy + (gy + ey) * c.halfDt;
+        s.vz = s.vz + (gz + ez) * c.halfDt;
+        Lane::clamp(s.vx, s.vy, s.vz, c.vmin, c.vmax);
+    }
+};
+
+// Classic fourth-order Runge-Kutta on (x, v); the clamp is applied to the
+// combined step.
+struct RungeKutta4 {
+    template <typename Lane>
+    static void step(LaneState<Lane>& s, const LaneForce<Lane>& f, const LaneConstants<Lane>& c) {
+        const Lane g1x = f.ax - s.vx * f.k;
+        const Lane g1y = f.ay - s.vy * f.k;
+        const Lane g1z = f.az - s.vz * f.k;
+        const Lane v2x = s.vx + g1x * c.halfDt;
+        const Lane v2y = s.vy + g1y * c.halfDt;
+        const Lane v2z = s.vz + g1z * c.halfDt;
+        const Lane g2x = f.ax - v2x * f.k;
+        const Lane g2y = f.ay - v2y * f.k;
+        const Lane g2z = f.az - v2z * f.k;
+        const Lane v3x = s.vx + g2x * c.halfDt;
+        const Lane v3y = s.vy + g2y * c.halfDt;
+        const Lane v3z = s.vz + g2z * c.halfDt;
+        const Lane g3x = f.ax - v3x * f.k;
+        const Lane g3y = f.ay - v3y * f.k;
+        const Lane g3z = f.az - v3z * f.k;
+        const Lane v4x = s.vx + g3x * c.dt;
+        const Lane v4y = s.vy + g3y * c.dt;
+        const Lane v4z = s.vz + g3z * c.dt;
+        const Lane g4x = f.ax - v4x * f.k;
+        const Lane g4y = f.ay - v4y * f.k;
+        const Lane g4z = f.az - v4z * f.k;
+        s.px = s.px + (s.vx + (v2x + v3x) * c.two + v4x) * c.sixthDt;
+        s.py = s.py + (s.vy + (v2y + v3y) * c.two + v4y) * c.sixthDt;
+        s.pz = s.pz + (s.vz + (v2z + v3z) * c.two + v4z) * c.sixthDt;
+        s.vx = s.vx + (g1x + (g2x + g3x) * c.two + g4x) * c.sixthDt;
+        s.vy = s.vy + (g1y + (g2y + g3y) * c.two + g4y) * c.sixthDt;
+        s.vz = s.vz + (g1z + (g2z + g3z) * c.two + g4z) * c.sixthDt;
+        Lane::clamp(s.vx, s.vy, s.vz, c.vmin, c.vmax);
+    }
+};
+
+// Cube walls at [lower, upper] on every axis, applied after each step with
+// min/max/select only. Reflecting and periodic walls assume a point crosses
+// at most one wall per axis and step, i.e. maxVelocity * dt < cube size.
+struct OpenBoundary {
+    template <typename Lane>
+    static void apply(LaneState<Lane>&, const LaneConstants<Lane>&) {}
+};
+
+// Mirrors the overshoot back into the cube and reverses that velocity
+// component. A point that overshoots by more than the cube is left on the
+// opposite wall.
+struct ReflectingBoundary {
+    template <typename Lane>
+    static void reflect(Lane& p, Lane& v, const LaneConstants<Lane>& c) {
+        const Lane wall = Lane::min(Lane::max(p, c.lower), c.upper);
+        v = Lane::select(p, wall, v, c.zero - v);
+        p = Lane::min(Lane::max(wall + wall - p, c.lower), c.upper);
+    }
+
+    template <typename Lane>
+    static void apply(LaneState<Lane>& s, const LaneConstants<Lane>& c) {
+        reflect(s.px, s.vx, c);
+        reflect(s.py, s.vy, c);
+        reflect(s.pz, s.vz, c);
+    }
+};
+
+struct PeriodicBoundary {
+    template <typename Lane>
+    static void wrap(Lane& p, const LaneConstants<Lane>& c) {
+        p = p + Lane::select(Lane::min(p, c.upper), p, c.zero, c.negativeSize);
+        p = p + Lane::select(Lane::max(p, c.lower), p, c.zero, c.size);
+    }
+
+    template <typename Lane>
+    static void apply(LaneState<Lane>& s, const LaneConstants<Lane>& c) {
+        wrap(s.px, c);
+        wrap(s.py, c);
+        wrap(s.pz, c);
+    }
+};
+
+// A point outside the cube gets NaN coordinates. NaN never compares equal,
+// so an absorbed point stays absorbed until ParticleStore::removeAbsorbed()
+// drops it.
+struct AbsorbingBoundary {
+    template <typename Lane>
+    static void apply(LaneState<Lane>& s, const LaneConstants<Lane>& c) {
+        const Lane dx = s.px - Lane::min(Lane::max(s.px, c.lower), c.upper);
+        const Lane dy = s.py - Lane::min(Lane::max(s.py, c.lower), c.upper);
+        const Lane dz = s.pz - Lane::min(Lane::max(s.pz, c.lower), c.upper);
+        const Lane outside = dx * dx + dy * dy + dz * dz;
+        s.px = Lane::select(outside, c.zero, s.px, c.absorbed);
+        s.py = Lane::select(outside, c.zero, s.py, c.absorbed);
+        s.pz = Lane::select(outside, c.zero, s.pz, c.absorbed);
+    }
+};
+
+// Runs all steps for the `count` points starting at i (count <= Lane::width)
+// with their state held in registers.
+template <typename Scheme, typename Boundary, typename Lane, typename Scalar>
+void integrateLanes(const KernelArrays<Scalar>& a, std::size_t i, std::size_t count, const LaneConstants<Lane>& c, int steps) {
+    const LaneForce<Lane> f = {
+        Lane::load(a.ax + i, count), Lane::load(a.ay + i, count), Lane::load(a.az + i, count),
+        Lane::load(a.friction + i, count)
+    };
+    LaneState<Lane> s = {
+        Lane::load(a.px + i, count), Lane::load(a.py + i, count), Lane::load(a.pz + i, count),
+        Lane::load(a.vx + i, count), Lane::load(a.vy + i, count), Lane::load(a.vz + i, count)
+    };
+
+    for (int step = 0; step < steps; ++step) {
+        Scheme::step(s, f, c);
+        Boundary::apply(s, c);
+    }
+
+    s.px.store(a.px + i, count);
+    s.py.store(a.py + i, count);
+    s.pz.store(a.pz + i, count);
+    s.vx.store(a.vx + i, count);
+    s.vy.store(a.vy + i, count);
+    s.vz.store(a.vz + i, count);
+}
+
+// Sums the forces of the `count` points starting at i (count <= Ways *
+// Lane::width) in force order and clamps each sum to [minAcceleration,
+// maxAcceleration]. The clamp divides by the magnitude and multiplies by the
+// limit, like normalized() * limit, and unclamped points divide and multiply
+// by one, so every ISA gives the same bits as the scalar code. Ways lane
+// groups are summed side by side, since one alone is bound by the add and
+// divide latency.
+template <typename Lane, int Ways>
+void sumForceLanes(const ForceBatch& b, std::size_t i, std::size_t count) {
+    const Lane zero = Lane::broadcast(0.0);
+    const Lane one = Lane::broadcast(1.0);
+    std::size_t lanes[Ways];
+    Lane x[Ways], y[Ways], z[Ways];
+    for (int w = 0; w < Ways; ++w) {
+        const std::size_t at = w * Lane::width;
+        lanes[w] = count > at ? (count - at < Lane::width ? count - at : Lane::width) : 0;
+        x[w] = zero;
+        y[w] = zero;
+        z[w] = zero;
+    }
+    for (std::size_t f = 0; f < b.numForces; ++f) {
+        const double* force = b.forces + 5 * f;
+        const Lane dx = Lane::broadcast(force[0]);
+        const Lane dy = Lane::broadcast(force[1]);
+        const Lane dz = Lane::broadcast(force[2]);
+        const Lane minimum = Lane::broadcast(force[3]);
+        const Lane range = Lane::broadcast(force[4]);
+        const double* draws = b.draws + f * b.count + i;
+        for (int w = 0; w < Ways; ++w) {
+            const Lane magnitude = minimum + range * Lane::load(draws + w * Lane::width, lanes[w]);
+            x[w] = x[w] + dx * magnitude;
+            y[w] = y[w] + dy * magnitude;
+            z[w] = z[w] + dz * magnitude;
+        }
+        if (b.roundToFloat && (f % 2 == 1 || f + 1 == b.numForces)) {
+            for (int w = 0; w < Ways; ++w) {
+                x[w] = Lane::roundToFloat(x[w]);
+                y[w] = Lane::roundToFloat(y[w]);
+                z[w] = Lane::roundToFloat(z[w]);
+            }
+        }
+    }
+
+    // magnitude > amax and magnitude < amin through min/max, since select()
+    // only compares for equality. A zero sum is never rescaled.
+    const Lane amin = Lane::broadcast(b.minAcceleration);
+    const Lane amax = Lane::broadcast(b.maxAcceleration);
+    for (int w = 0; w < Ways; ++w) {
+        if (lanes[w] == 0) {
+            break;
+        }
+        const Lane magnitude = Lane::sqrt(x[w] * x[w] + y[w] * y[w] + z[w] * z[w]);
+        const Lane above = Lane::max(magnitude, amax);
+        const Lane below = Lane::min(magnitude, amin);
+        const Lane divisor = Lane::select(magnitude, zero, one,
+                                          Lane::select(above, amax, Lane::select(below, amin, one, magnitude), magnitude));
+        const Lane limit = Lane::select(magnitude, zero, one,
+                                        Lane::select(above, amax, Lane::select(below, amin, one, amin), amax));
+        const std::size_t at = i + w * Lane::width;
+        (x[w] / divisor * limit).store(b.ax + at, lanes[w]);
+        (y[w] / divisor * limit).store(b.ay + at, lanes[w]);
+        (z[w] / divisor * limit).store(b.az + at, lanes[w]);
+    }
+}
+
+// Explicit instantiations of an ISA's kernel for every scheme, boundary and
+// scalar type.
+#define POINTSIM_INSTANTIATE_BOUNDARIES(kernel, Scheme, Scalar) \
+    template void kernel<Scheme, OpenBoundary>(const KernelArrays<Scalar>&, std::size_t, std::size_t, const KernelParams&); \
+    template void kernel<Scheme, ReflectingBoundary>(const KernelArrays<Scalar>&, std::size_t, std::size_t, const KernelParams&); \
+    template void kernel<Scheme, PeriodicBoundary>(const KernelArrays<Scalar>&, std::size_t, std::size_t, const KernelParams&); \
+    template void kernel<Scheme, AbsorbingBoundary>(const KernelArrays<Scalar>&, std::size_t, std::size_t, const KernelParams&);
+
+#define POINTSIM_INSTANTIATE_SCHEMES(kernel, Scalar) \
+    POINTSIM_INSTANTIATE_BOUNDARIES(kernel, ExplicitEuler, Scalar) \
+    POINTSIM_INSTANTIATE_BOUNDARIES(kernel, SemiImplicitEuler, Scalar) \
+    POINTSIM_INSTANTIATE_BOUNDARIES(kernel, VelocityVerlet, Scalar) \
+    POINTSIM_INSTANTIATE_BOUNDARIES(kernel, RungeKutta4, Scalar)
+
+#define POINTSIM_INSTANTIATE_KERNELS(kernel) \
+    POINTSIM_INSTANTIATE_SCHEMES(kernel, double) \
+    POINTSIM_INSTANTIATE_SCHEMES(kernel, float)
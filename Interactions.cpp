@@ -0,0 +1,98 @@
+#include "Interactions.h"
+#include <algorithm>
+#include <cmath>
+
+Interactions::Interactions(const InteractionParams& params, const Walls& walls, std::size_t maxPoints)
+    : params(params) {
+    grid.configure(walls.lower, walls.upper, params.radius, walls.mode == BoundaryMode::Periodic, maxPoints);
+}
+
+void Interactions::update(const ParticleStore& points, ThreadPool& pool, const AccelerationField& base) {
+    grid.build(points, pool);
+
+    const std::size_t n = points.size();
+    ax.resize(n);
+    ay.resize(n);
+    az.resize(n);
+
+    // Cells, then the buckets of points outside the cube, then the bucket
+    // of absorbed points.
+    const std::size_t cells = grid.cellCount() + grid.bucketCount() + 1;
+    const std::size_t grain = std::max<std::size_t>(1, cells / (8 * pool.size()));
+    pool.parallelFor(cells, grain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            if (grid.periodic()) {
+                accumulate<true>(base, c);
+            } else {
+                accumulate<false>(base, c);
+            }
+        }
+    });
+}
+
+template <bool Periodic>
+void Interactions::accumulate(const AccelerationField& base, std::size_t cell) {
+    const std::vector<std::uint32_t>& order = grid.order();
+    const std::size_t buckets = grid.cellCount() + grid.bucketCount();
+    const CellList::Range own = cell < buckets ? grid.cell(cell) : grid.absorbed();
+    if (own.begin == own.end) {
+        return;
+    }
+    // A bucket may hold points of different cells, so its points look up
+    // their neighbours one by one.
+    const bool inCube = cell < grid.cellCount();
+    CellList::Range neighbours[27];
+    std::size_t neighbourCount = inCube ? grid.neighbours(cell, neighbours) : 0;
+
+    const double diameter = params.radius;
+    const double stiffness = params.stiffness;
+    const double damping = params.damping;
+    const double diameterSquared = diameter * diameter;
+    const double box = grid.boxSize();
+    const double halfBox = 0.5 * box;
+
+    for (std::uint32_t k = own.begin; k < own.end; ++k) {
+        const double xi = grid.px[k], yi = grid.py[k], zi = grid.pz[k];
+        const double vxi = grid.vx[k], vyi = grid.vy[k], vzi = grid.vz[k];
+        double fx = 0.0, fy = 0.0, fz = 0.0;
+        if (!inCube && cell < buckets) {
+            neighbourCount = grid.neighboursOf(k, neighbours);
+        }
+
+        for (std::size_t m = 0; m < neighbourCount; ++m) {
+            for (std::uint32_t j = neighbours[m].begin; j < neighbours[m].end; ++j) {
+                double dx = xi - grid.px[j];
+                double dy = yi - grid.py[j];
+                double dz = zi - grid.pz[j];
+                // Periodic walls keep positions inside the cube, so the
+                // nearest image is at most one box away.
+                if (Periodic) {
+                    dx += dx > halfBox ? -box : (dx < -halfBox ? box : 0.0);
+                    dy += dy > halfBox ? -box : (dy < -halfBox ? box : 0.0);
+                    dz += dz > halfBox ? -box : (dz < -halfBox ? box : 0.0);
+                }
+                const double r2 = dx * dx + dy * dy + dz * dz;
+                // Also skips the point itself and exactly coincident points,
+                // which have no contact normal.
+                if (!(r2 < diameterSquared) || r2 == 0.0) {
+                    continue;
+                }
+                const double r = std::sqrt(r2);
+                const double inverseR = 1.0 / r;
+                const double approach = ((vxi - grid.vx[j]) * dx + (vyi - grid.vy[j]) * dy + (vzi - grid.vz[j]) * dz) * inverseR;
+                const double push = stiffness * (diameter - r) - damping * approach;
+                if (push > 0.0) {
+                    const double scale = push * inverseR;
+                    fx += scale * dx;
+                    fy += scale * dy;
+                    fz += scale * dz;
+                }
+            }
+        }
+
+        const std::uint32_t i = order[k];
+        ax[i] = base.x[i] + fx;
+        ay[i] = base.y[i] + fy;
+        az[i] = base.z[i] + fz;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "AlignedVector.h"
+#include "CellList.h"
+#include "IntegrationKernel.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include <cstddef>
+
+struct InteractionParams {
+    // Contact distance (particle diameter); 0 disables interactions.
+    double radius = 0.0;
+    // Repulsive acceleration per unit overlap.
+    double stiffness = 0.0;
+    // Damping of the approach speed along the contact normal.
+    double damping = 0.0;
+};
+
+// Soft-sphere contacts between points closer than `radius`: a linear spring
+// on the overlap plus a normal dashpot, never attractive. update() rebuilds
+// the cell list and writes each point's `base` acceleration plus its contact
+// accelerations into ax/ay/az. Every point sums its own contacts
+// (each pair is evaluated from both sides), so the parallel loop needs no
+// atomics and the result does not depend on the thread count.
+class Interactions {
+public:
+    Interactions(const InteractionParams& params, const Walls& walls, std::size_t maxPoints);
+
+    void update(const ParticleStore& points, ThreadPool& pool, const AccelerationField& base);
+    AccelerationField field() const { return {ax.data(), ay.data(), az.data()}; }
+    // Morton order of the last update(), for ParticleStore::permute.
+    const std::vector<std::uint32_t>& order() const { return grid.order(); }
+
+private:
+    template <bool Periodic>
+    void accumulate(const AccelerationField& base, std::size_t cell);
+
+    InteractionParams params;
+    CellList grid;
+    AlignedVector<double> ax, ay, az;
+};
@@ -0,0 +1,205 @@
+#include "OutputPipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+namespace {
+
+std::uint64_t nowNanos() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+}
+
+OutputPipeline::OutputPipeline(std::size_t queueDepth, unsigned writerThreads)
+    : queueDepth(std::max<std::size_t>(queueDepth, 1)), writerThreads(std::max(writerThreads, 1u)) {
+}
+
+OutputPipeline::~OutputPipeline() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+void OutputPipeline::addSink(std::unique_ptr<FrameSink> sink) {
+    sinks.push_back(std::move(sink));
+}
+
+bool OutputPipeline::wantsFrame(int timeStep) const {
+    for (const auto& sink : sinks) {
+        if (sink->wants(timeStep)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OutputPipeline::start() {
+    stats.reset(new SinkStats[sinks.size()]);
+    startNanos = nowNanos();
+    writers.reserve(writerThreads);
+    for (unsigned i = 0; i < writerThreads; ++i) {
+        writers.emplace_back(&OutputPipeline::writerLoop, this);
+    }
+}
+
+Frame& OutputPipeline::acquire() {
+    if (writers.empty()) {
+        start();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (freeFrames.empty() && frames.size() < queueDepth) {
+        frames.push_back(std::make_unique<Frame>());
+        freeFrames.push_back(frames.back().get());
+    }
+
+    const std::uint64_t waitStart = nowNanos();
+    frameFree.wait(lock, [this] { return !freeFrames.empty() || error; });
+    stallSeconds += (nowNanos() - waitStart) * 1e-9;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    Frame* frame = freeFrames.back();
+    freeFrames.pop_back();
+    return *frame;
+}
+
+void OutputPipeline::submit(Frame& frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        frame.sequence = nextSequence++;
+        queue.push_back(&frame);
+    }
+    frameQueued.notify_one();
+}
+
+void OutputPipeline::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+
+    if (!writers.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+        }
+        frameQueued.notify_all();
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        wallSeconds = (nowNanos() - startNanos) * 1e-9;
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    for (auto& sink : sinks) {
+        sink->finish();
+    }
+}
+
+void OutputPipeline::writerLoop() {
+    for (;;) {
+        Frame* frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameQueued.wait(lock, [this] { return closing || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            frame = queue.front();
+            queue.pop_front();
+        }
+
+        runFrame(*frame);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeFrames.push_back(frame);
+            ++framesWritten;
+        }
+        frameFree.notify_one();
+    }
+}
+
+void OutputPipeline::runFrame(Frame& frame) {
+    bool failed = false;
+    try {
+        for (std::size_t i = 0; i < sinks.size(); ++i) {
+            if (!sinks[i]->wants(frame.timeStep)) {
+                continue;
+            }
+            const std::uint64_t start = nowNanos();
+            stats[i].bytes += sinks[i]->process(frame);
+            stats[i].processNanos += nowNanos() - start;
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = true;
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    turn.wait(lock, [&] { return nextCommit == frame.sequence; });
+    failed = failed || error;
+    lock.unlock();
+
+    if (!failed) {
+        try {
+            for (std::size_t i = 0; i < sinks.size(); ++i) {
+                if (!sinks[i]->wants(frame.timeStep)) {
+                    continue;
+                }
+                const std::uint64_t start = nowNanos();
+                stats[i].bytes += sinks[i]->commit(frame);
+                stats[i].commitNanos += nowNanos() - start;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> errorLock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    lock.lock();
+    ++nextCommit;
+    lock.unlock();
+    turn.notify_all();
+    frameFree.notify_all();
+}
+
+void OutputPipeline::printReport(std::ostream& out) const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3);
+    oss << "Output pipeline: " << framesWritten << " frames, " << writerThreads
+        << " writer thread(s), queue depth " << queueDepth << "\n";
+    oss << "  integrate  " << std::setw(10) << computeSeconds << " s\n";
+    oss << "  snapshot   " << std::setw(10) << snapshotSeconds << " s\n";
+    oss << "  stall      " << std::setw(10) << stallSeconds << " s\n";
+
+    for (std::size_t i = 0; i < sinks.size() && stats; ++i) {
+        const double seconds = (stats[i].processNanos + stats[i].commitNanos) * 1e-9;
+        const double megabytes = stats[i].bytes / (1024.0 * 1024.0);
+        oss << "  " << std::left << std::setw(10) << sinks[i]->name() << std::right << " "
+            << std::setw(10) << seconds << " s  " << megabytes << " MB";
+        if (seconds > 0.0) {
+            oss << "  " << megabytes / seconds << " MB/s";
+        }
+        oss << "\n";
+    }
+    oss << "  wall       " << std::setw(10) << wallSeconds << " s\n";
+
+    out << oss.str();
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "ParticleStore.h"
+#include "VoxelGrid.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Snapshot of the simulation at one output time. Frames are pooled and
+// reused, so their buffers keep their capacity between output times.
+// timeStep is the output index, time the simulated time in seconds. Only the
+// store matching `precision` holds the points, or just the sampled points
+// with subsample set; grid is filled only with voxel_grid set.
+struct Frame {
+    std::uint64_t sequence = 0;
+    int timeStep = 0;
+    double time = 0.0;
+    Precision precision = Precision::Double;
+    ParticleStore points;
+    FloatParticleStore floatPoints;
+    VoxelGrid grid;
+    std::string text;
+    std::size_t textLength = 0;
+
+    template <typename Scalar>
+    BasicParticleStore<Scalar>& store() {
+        if constexpr (std::is_same<Scalar, float>::value) {
+            return floatPoints;
+        } else {
+            return points;
+        }
+    }
+};
+
+// Consumer of output frames. process() may run concurrently for different
+// frames on different writer threads; commit() is called once per frame, in
+// frame order, and is the place for anything that must be sequential
+// (stdout, collection files). Both return the number of bytes they wrote.
+// Sinks only see the output times they want; finish() runs once after the
+// last frame has been committed.
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+    virtual const char* name() const = 0;
+    virtual bool wants(int timeStep) const { (void)timeStep; return true; }
+    // Frames get a voxel grid only while some sink asks for it.
+    virtual bool wantsGrid() const { return false; }
+    virtual std::size_t process(Frame& frame) = 0;
+    virtual std::size_t commit(Frame& frame) { (void)frame; return 0; }
+    virtual void finish() {}
+};
+
+// Producer/consumer output stage. The simulator acquires a pooled frame,
+// copies its state into it and submits it; background writer threads run the
+// sinks. acquire() blocks once queueDepth frames are in flight.
+class OutputPipeline {
+public:
+    OutputPipeline(std::size_t queueDepth, unsigned writerThreads);
+    ~OutputPipeline();
+
+    OutputPipeline(const OutputPipeline&) = delete;
+    OutputPipeline& operator=(const OutputPipeline&) = delete;
+
+    void addSink(std::unique_ptr<FrameSink> sink);
+    bool hasSinks() const { return !sinks.empty(); }
+    bool wantsFrame(int timeStep) const;
+
+    Frame& acquire();
+    void submit(Frame& frame);
+    void finish();
+
+    void recordCompute(double seconds) { computeSeconds += seconds; }
+    void recordSnapshot(double seconds) { snapshotSeconds += seconds; }
+    void printReport(std::ostream& out) const;
+
+private:
+    struct SinkStats {
+        std::atomic<std::uint64_t> processNanos{0};
+        std::atomic<std::uint64_t> commitNanos{0};
+        std::atomic<std::uint64_t> bytes{0};
+    };
+
+    void start();
+    void writerLoop();
+    void runFrame(Frame& frame);
+
+    std::size_t queueDepth;
+    unsigned writerThreads;
+    std::vector<std::unique_ptr<FrameSink>> sinks;
+    std::unique_ptr<SinkStats[]> stats;
+
+    std::vector<std::unique_ptr<Frame>> frames;
+    std::vector<Frame*> freeFrames;
+    std::deque<Frame*> queue;
+    std::vector<std::thread> writers;
+
+    std::mutex mutex;
+    std::condition_variable frameFree;
+    std::condition_variable frameQueued;
+    std::condition_variable turn;
+    std::uint64_t nextSequence = 0;
+    std::uint64_t nextCommit = 0;
+    bool closing = false;
+    bool finished = false;
+    std::exception_ptr error;
+
+    double computeSeconds = 0.0;
+    double snapshotSeconds = 0.0;
+    double stallSeconds = 0.0;
+    double wallSeconds = 0.0;
+    std::uint64_t framesWritten = 0;
+    std::uint64_t startNanos = 0;
+};
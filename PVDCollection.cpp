@@ -0,0 +1,30 @@
+#include "PVDCollection.h"
+#include <iostream>
+
+PVDCollection::PVDCollection(const std::string& filename) : path(filename), file(filename, std::ios::out | std::ios::trunc) {
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open collection file: " << path << std::endl;
+        return;
+    }
+    file << "<?xml version=\"1.0\"?>\n";
+    file << "<VTKFile type=\"Collection\" version=\"0.1\">\n";
+    file << "  <Collection>\n";
+    footerPos = file.tellp();
+    writeFooter();
+}
+
+void PVDCollection::addDataSet(double time, const std::string& dataSetFile) {
+    if (!file.is_open()) {
+        return;
+    }
+    file.seekp(footerPos);
+    file << "    <DataSet timestep=\"" << time << "\" file=\"" << dataSetFile << "\"/>\n";
+    footerPos = file.tellp();
+    writeFooter();
+}
+
+void PVDCollection::writeFooter() {
+    file << "  </Collection>\n";
+    file << "</VTKFile>\n";
+    file.flush();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <fstream>
+#include <string>
+
+// ParaView .pvd collection that is appended to frame by frame. The closing
+// tags are rewritten after every entry, so the file is a valid collection
+// even if the run is interrupted.
+class PVDCollection {
+public:
+    explicit PVDCollection(const std::string& filename);
+
+    void addDataSet(double time, const std::string& file);
+    const std::string& filename() const { return path; }
+    bool isOpen() const { return file.is_open(); }
+
+private:
+    void writeFooter();
+
+    std::string path;
+    std::ofstream file;
+    std::streampos footerPos;
+};
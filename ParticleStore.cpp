@@ -0,0 +1,127 @@
+#include "ParticleStore.h"
+#include <cmath>
+
+template <typename Scalar>
+void BasicParticleStore<Scalar>::clear() {
+    px.clear(); py.clear(); pz.clear();
+    vx.clear(); vy.clear(); vz.clear();
+    ax.clear(); ay.clear(); az.clear();
+    friction.clear();
+    ids.clear();
+    indexed = false;
+}
+
+template <typename Scalar>
+void BasicParticleStore<Scalar>::reserve(std::size_t n) {
+    px.reserve(n); py.reserve(n); pz.reserve(n);
+    vx.reserve(n); vy.reserve(n); vz.reserve(n);
+    ax.reserve(n); ay.reserve(n); az.reserve(n);
+    friction.reserve(n);
+}
+
+template <typename Scalar>
+void BasicParticleStore<Scalar>::resize(std::size_t n) {
+    px.resize(n); py.resize(n); pz.resize(n);
+    vx.resize(n); vy.resize(n); vz.resize(n);
+    ax.resize(n); ay.resize(n); az.resize(n);
+    friction.resize(n);
+    if (indexed) {
+        ids.resize(n);
+    }
+}
+
+template <typename Scalar>
+void BasicParticleStore<Scalar>::push_back(const Point& point) {
+    px.push_back(point.position.x);
+    py.push_back(point.position.y);
+    pz.push_back(point.position.z);
+    vx.push_back(point.velocity.x);
+    vy.push_back(point.velocity.y);
+    vz.push_back(point.velocity.z);
+    ax.push_back(point.acceleration.x);
+    ay.push_back(point.acceleration.y);
+    az.push_back(point.acceleration.z);
+    friction.push_back(point.frictionCoefficient);
+    if (indexed) {
+        ids.push_back(static_cast<std::uint32_t>(ids.size()));
+    }
+}
+
+template <typename Scalar>
+void BasicParticleStore<Scalar>::set(std::size_t i, const Point& point) {
+    px[i] = point.position.x;
+    py[i] = point.position.y;
+    pz[i] = point.position.z;
+    vx[i] = point.velocity.x;
+    vy[i] = point.velocity.y;
+    vz[i] = point.velocity.z;
+    ax[i] = point.acceleration.x;
+    ay[i] = point.acceleration.y;
+    az[i] = point.acceleration.z;
+    friction[i] = point.frictionCoefficient;
+}
+
+template <typename Scalar>
+Point BasicParticleStore<Scalar>::get(std::size_t i) const {
+    Point point(Vector3D(position(i)), Vector3D(velocity(i)), Vector3D(acceleration(i)), friction[i]);
+    point.setVelocityLimits(limits.minVelocity, limits.maxVelocity);
+    point.setAccelerationLimits(limits.minAcceleration, limits.maxAcceleration);
+    return point;
+}
+
+template <typename Scalar>
+std::size_t BasicParticleStore<Scalar>::removeAbsorbed() {
+    const std::size_t n = size();
+    std::size_t first = 0;
+    while (first < n && !std::isnan(px[first])) {
+        ++first;
+    }
+    if (first == n) {
+        return 0;
+    }
+
+    if (!indexed) {
+        ids.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            ids[i] = static_cast<std::uint32_t>(i);
+        }
+        indexed = true;
+    }
+
+    std::size_t kept = first;
+    for (std::size_t i = first + 1; i < n; ++i) {
+        if (std::isnan(px[i])) {
+            continue;
+        }
+        px[kept] = px[i]; py[kept] = py[i]; pz[kept] = pz[i];
+        vx[kept] = vx[i]; vy[kept] = vy[i]; vz[kept] = vz[i];
+        ax[kept] = ax[i]; ay[kept] = ay[i]; az[kept] = az[i];
+        friction[kept] = friction[i];
+        ids[kept] = ids[i];
+        ++kept;
+    }
+    resize(kept);
+    return n - kept;
+}
+
+template <typename Scalar>
+void BasicParticleStore<Scalar>::permute(const std::vector<std::uint32_t>& order) {
+    const std::size_t n = size();
+    AlignedVector<std::uint32_t> permutedIds(n);
+    for (std::size_t k = 0; k < n; ++k) {
+        permutedIds[k] = static_cast<std::uint32_t>(id(order[k]));
+    }
+    ids.swap(permutedIds);
+    indexed = true;
+
+    AlignedVector<Scalar> scratch(n);
+    for (AlignedVector<Scalar>* component : {&px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &friction}) {
+        for (std::size_t k = 0; k < n; ++k) {
+            scratch[k] = (*component)[order[k]];
+        }
+        component->swap(scratch);
+    }
+}
+
+template class BasicParticleStore<double>;
+template class BasicParticleStore<float>;
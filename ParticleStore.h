@@ -0,0 +1,70 @@
+#pragma once
+#include "AlignedVector.h"
+#include "Point.h"
+#include "Vector3D.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Limits shared by every point; stored once instead of per point.
+struct ParticleLimits {
+    double minVelocity;
+    double maxVelocity;
+    double minAcceleration;
+    double maxAcceleration;
+};
+
+// Scalar type of the particle state. Float halves the memory traffic and
+// doubles the SIMD width; the RNG draws and the limits stay double.
+enum class Precision { Double, Float };
+
+// Structure-of-arrays particle container. Each field component lives in its
+// own 64-byte aligned array so the integration loop only streams the data it
+// actually touches.
+template <typename Scalar>
+class BasicParticleStore {
+public:
+    AlignedVector<Scalar> px, py, pz;
+    AlignedVector<Scalar> vx, vy, vz;
+    AlignedVector<Scalar> ax, ay, az;
+    AlignedVector<Scalar> friction;
+    // Original index of each point, kept once points were removed or
+    // reordered (indexed); until then ids is empty and point i is the
+    // original point i. The flag is separate because a store whose points
+    // were all removed is empty too.
+    AlignedVector<std::uint32_t> ids;
+    bool indexed = false;
+    ParticleLimits limits;
+
+    static constexpr std::size_t bytesPerPoint = 10 * sizeof(Scalar);
+
+    BasicParticleStore() : limits{0.0, 0.0, 0.0, 0.0} {}
+
+    std::size_t size() const { return px.size(); }
+    bool empty() const { return px.empty(); }
+
+    void clear();
+    void reserve(std::size_t n);
+    // New elements are left uninitialized.
+    void resize(std::size_t n);
+
+    void push_back(const Point& point);
+    void set(std::size_t i, const Point& point);
+    Point get(std::size_t i) const;
+
+    std::size_t id(std::size_t i) const { return indexed ? ids[i] : i; }
+    // Drops points whose position was set to NaN by an absorbing wall,
+    // keeping the order of the rest. Returns the number removed.
+    std::size_t removeAbsorbed();
+    // Reorders the points so that new point k is old point order[k].
+    void permute(const std::vector<std::uint32_t>& order);
+
+    Vector3<Scalar> position(std::size_t i) const { return Vector3<Scalar>(px[i], py[i], pz[i]); }
+    Vector3<Scalar> velocity(std::size_t i) const { return Vector3<Scalar>(vx[i], vy[i], vz[i]); }
+    Vector3<Scalar> acceleration(std::size_t i) const { return Vector3<Scalar>(ax[i], ay[i], az[i]); }
+};
+
+// Both are explicitly instantiated in ParticleStore.cpp.
+using ParticleStore = BasicParticleStore<double>;
+using FloatParticleStore = BasicParticleStore<float>;
+
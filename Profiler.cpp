@@ -0,0 +1,188 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+std::atomic<bool> Profiler::active{false};
+
+namespace {
+
+const std::size_t phaseCount = static_cast<std::size_t>(ProfilePhase::Count);
+
+struct PhaseTotals {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> nanos{0};
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<std::uint64_t> points{0};
+};
+
+struct ProfileState {
+    PhaseTotals totals[phaseCount];
+    // [phase * timeSteps + timeStep]
+    std::unique_ptr<std::atomic<std::uint64_t>[]> secondNanos;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> secondBytes;
+    int timeSteps = 0;
+    std::size_t numPoints = 0;
+    std::uint64_t startNanos = 0;
+};
+
+ProfileState state;
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+double rate(std::uint64_t amount, double seconds) {
+    return seconds > 0.0 ? amount / seconds : 0.0;
+}
+
+}
+
+void Profiler::enable(std::size_t numPoints, int timeSteps) {
+    state.timeSteps = timeSteps > 0 ? timeSteps : 0;
+    state.numPoints = numPoints;
+
+    const std::size_t slots = phaseCount * static_cast<std::size_t>(state.timeSteps);
+    state.secondNanos.reset(new std::atomic<std::uint64_t>[slots]);
+    state.secondBytes.reset(new std::atomic<std::uint64_t>[slots]);
+    for (std::size_t i = 0; i < slots; ++i) {
+        state.secondNanos[i].store(0, std::memory_order_relaxed);
+        state.secondBytes[i].store(0, std::memory_order_relaxed);
+    }
+    for (auto& totals : state.totals) {
+        totals.calls.store(0, std::memory_order_relaxed);
+        totals.nanos.store(0, std::memory_order_relaxed);
+        totals.bytes.store(0, std::memory_order_relaxed);
+        totals.points.store(0, std::memory_order_relaxed);
+    }
+
+    state.startNanos = now();
+    active.store(true, std::memory_order_release);
+}
+
+void Profiler::disable() {
+    active.store(false, std::memory_order_release);
+}
+
+std::uint64_t Profiler::now() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::record(ProfilePhase phase, int timeStep, std::uint64_t nanos, std::uint64_t bytes, std::uint64_t points) {
+    const std::size_t p = static_cast<std::size_t>(phase);
+    PhaseTotals& totals = state.totals[p];
+    totals.calls.fetch_add(1, std::memory_order_relaxed);
+    totals.nanos.fetch_add(nanos, std::memory_order_relaxed);
+    totals.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    totals.points.fetch_add(points, std::memory_order_relaxed);
+
+    // Work outside the time loop (e.g. initialization) only counts in the totals.
+    if (timeStep >= 0 && timeStep < state.timeSteps) {
+        const std::size_t slot = p * static_cast<std::size_t>(state.timeSteps) + static_cast<std::size_t>(timeStep);
+        state.secondNanos[slot].fetch_add(nanos, std::memory_order_relaxed);
+        state.secondBytes[slot].fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+const char* Profiler::phaseName(ProfilePhase phase) {
+    switch (phase) {
+        case ProfilePhase::Init: return "init";
+        case ProfilePhase::Integrate: return "integrate";
+        case ProfilePhase::Interactions: return "interactions";
+        case ProfilePhase::PairForces: return "pair_forces";
+        case ProfilePhase::Stall: return "stall";
+        case ProfilePhase::Snapshot: return "snapshot";
+        case ProfilePhase::TextFormat: return "text_format";
+        case ProfilePhase::TextWrite: return "text_write";
+        case ProfilePhase::VTKBuild: return "vtk_build";
+        case ProfilePhase::VTKWrite: return "vtk_write";
+        case ProfilePhase::VTKCollection: return "vtk_collection";
+        case ProfilePhase::Trajectory: return "trajectory";
+        case ProfilePhase::Checkpoint: return "checkpoint";
+        case ProfilePhase::VoxelGrid: return "voxel_grid";
+        case ProfilePhase::VTKGrid: return "vtk_grid";
+        case ProfilePhase::Count: break;
+    }
+    return "unknown";
+}
+
+bool Profiler::writeReport(const std::string& filename) {
+    const double wallSeconds = (now() - state.startNanos) * 1e-9;
+    const bool csv = endsWith(filename, ".csv");
+
+    std::ostringstream out;
+    out << std::setprecision(9);
+
+    if (csv) {
+        out << "phase,time_step,calls,seconds,bytes,points\n";
+        out << "wall,total,1," << wallSeconds << ",0," << state.numPoints << "\n";
+    } else {
+        out << "{\n";
+        out << "  \"wall_seconds\": " << wallSeconds << ",\n";
+        out << "  \"points\": " << state.numPoints << ",\n";
+        out << "  \"time_steps\": " << state.timeSteps << ",\n";
+        out << "  \"phases\": [";
+    }
+
+    bool first = true;
+    for (std::size_t p = 0; p < phaseCount; ++p) {
+        const PhaseTotals& totals = state.totals[p];
+        const std::uint64_t calls = totals.calls.load(std::memory_order_relaxed);
+        if (calls == 0) {
+            continue;
+        }
+        const char* name = phaseName(static_cast<ProfilePhase>(p));
+        const double seconds = totals.nanos.load(std::memory_order_relaxed) * 1e-9;
+        const std::uint64_t bytes = totals.bytes.load(std::memory_order_relaxed);
+        const std::uint64_t points = totals.points.load(std::memory_order_relaxed);
+        const std::atomic<std::uint64_t>* nanosPerSecond = state.secondNanos.get() + p * state.timeSteps;
+        const std::atomic<std::uint64_t>* bytesPerSecond = state.secondBytes.get() + p * state.timeSteps;
+
+        if (csv) {
+            out << name << ",total," << calls << "," << seconds << "," << bytes << "," << points << "\n";
+            const bool inLoop = std::any_of(nanosPerSecond, nanosPerSecond + state.timeSteps,
+                                            [](const std::atomic<std::uint64_t>& n) { return n.load(std::memory_order_relaxed) != 0; });
+            for (int t = 0; inLoop && t < state.timeSteps; ++t) {
+                out << name << "," << t << ",," << nanosPerSecond[t].load(std::memory_order_relaxed) * 1e-9
+                    << "," << bytesPerSecond[t].load(std::memory_order_relaxed) << ",\n";
+            }
+            continue;
+        }
+
+        out << (first ? "\n" : ",\n");
+        out << "    {\"phase\": \"" << name << "\""
+            << ", \"calls\": " << calls
+            << ", \"seconds\": " << seconds
+            << ", \"bytes\": " << bytes
+            << ", \"points\": " << points
+            << ", \"bytes_per_second\": " << rate(bytes, seconds)
+            << ", \"points_per_second\": " << rate(points, seconds)
+            << ",\n     \"seconds_per_time_step\": [";
+        for (int t = 0; t < state.timeSteps; ++t) {
+            out << (t ? ", " : "") << nanosPerSecond[t].load(std::memory_order_relaxed) * 1e-9;
+        }
+        out << "],\n     \"bytes_per_time_step\": [";
+        for (int t = 0; t < state.timeSteps; ++t) {
+            out << (t ? ", " : "") << bytesPerSecond[t].load(std::memory_order_relaxed);
+        }
+        out << "]}";
+        first = false;
+    }
+
+    if (!csv) {
+        out << "\n  ]\n}\n";
+    }
+
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "Error: Could not open profile output file: " << filename << std::endl;
+        return false;
+    }
+    file << out.str();
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class ProfilePhase {
+    Init,
+    Integrate,
+    Interactions,
+    PairForces,
+    Stall,
+    Snapshot,
+    TextFormat,
+    TextWrite,
+    VTKBuild,
+    VTKWrite,
+    VTKCollection,
+    Trajectory,
+    Checkpoint,
+    VoxelGrid,
+    VTKGrid,
+    Count
+};
+
+// Process-wide phase timers for --profile. Each phase keeps a call count,
+// total time, bytes and points, plus a histogram of time and bytes per
+// output time. Recording is lock-free and may happen on any thread. While the
+// profiler is disabled a ProfileScope costs one branch; building with
+// POINTSIM_NO_PROFILER removes it entirely.
+class Profiler {
+public:
+#ifdef POINTSIM_NO_PROFILER
+    static constexpr bool enabled() { return false; }
+#else
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+#endif
+
+    // Resets all counters; timeSteps sizes the per-output-time histograms.
+    static void enable(std::size_t numPoints, int timeSteps);
+    static void disable();
+
+    static std::uint64_t now();
+    static void record(ProfilePhase phase, int timeStep, std::uint64_t nanos, std::uint64_t bytes, std::uint64_t points);
+
+    static const char* phaseName(ProfilePhase phase);
+    // Writes CSV if filename ends in .csv, JSON otherwise.
+    static bool writeReport(const std::string& filename);
+
+private:
+    static std::atomic<bool> active;
+};
+
+class ProfileScope {
+public:
+    ProfileScope(ProfilePhase phase, int timeStep)
+        : phase(phase), timeStep(timeStep), start(Profiler::enabled() ? Profiler::now() : 0) {}
+    ~ProfileScope() { stop(); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    void add(std::uint64_t byteCount, std::uint64_t pointCount) {
+        bytes += byteCount;
+        points += pointCount;
+    }
+
+    void stop() {
+        if (start) {
+            Profiler::record(phase, timeStep, Profiler::now() - start, bytes, points);
+            start = 0;
+        }
+    }
+
+private:
+    ProfilePhase phase;
+    int timeStep;
+    std::uint64_t start;
+    std::uint64_t bytes = 0;
+    std::uint64_t points = 0;
+};
@@ -1,8 +1,123 @@
 #include "SimulationGUI.h"
+#include "TextFrameSink.h"
 #include <QtWidgets/QMessageBox>
 #include <QApplication>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <memory>
+
+#ifdef POINTSIM_HAVE_VTK
+#include "VTKWriter.h"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// At most this many points per logged frame and frames per second reach the
+// output widget, however large the run.
+const std::size_t maxLogPoints = 20;
+const int maxLogFrames = 200;
+const auto minimumLogGap = std::chrono::milliseconds(200);
+const auto minimumProgressGap = std::chrono::milliseconds(100);
+
+// Sends an evenly strided sample of the positions to the GUI log. Frames are
+// picked by a fixed stride, so the pipeline only snapshots those, and then
+// dropped in commit() if the previous one went out less than
+// minimumLogGap ago. The last output time is always sent.
+class LogFrameSink : public FrameSink {
+public:
+    LogFrameSink(int outputCount, std::function<void(const QString&)> send)
+        : lastTimeStep(outputCount - 1), timeStride(std::max(1, (outputCount + maxLogFrames - 1) / maxLogFrames)),
+          send(std::move(send)) {}
+
+    const char* name() const override { return "log"; }
+    bool wants(int timeStep) const override { return timeStep % timeStride == 0 || timeStep == lastTimeStep; }
+    std::size_t process(Frame&) override { return 0; }
+
+    std::size_t commit(Frame& frame) override {
+        const auto now = Clock::now();
+        if (frame.timeStep != lastTimeStep && sentAny && now - lastSent < minimumLogGap) {
+            return 0;
+        }
+        sentAny = true;
+        lastSent = now;
+
+        const std::size_t count = frame.precision == Precision::Float ? frame.floatPoints.size() : frame.points.size();
+        const int stride = static_cast<int>(std::max<std::size_t>(1, (count + maxLogPoints - 1) / maxLogPoints));
+        std::ostringstream header;
+        header << std::fixed << std::setprecision(3) << "Time: " << frame.time << " seconds";
+        if (stride > 1) {
+            header << " (" << (count + stride - 1) / stride << " of " << count << " points)";
+        }
+        header << "\n";
+        text = header.str();
+        const std::size_t length = frame.precision == Precision::Float
+                                       ? TextFrameSink::formatPoints(frame.floatPoints, stride, text, text.size())
+                                       : TextFrameSink::formatPoints(frame.points, stride, text, text.size());
+        send(QString::fromUtf8(text.data(), static_cast<int>(length)).trimmed());
+        return length;
+    }
+
+private:
+    int lastTimeStep;
+    int timeStride;
+    std::function<void(const QString&)> send;
+    std::string text;
+    bool sentAny = false;
+    Clock::time_point lastSent;
+};
+
+}
+
+SimulationWorker::SimulationWorker(const SimulationParams& params)
+    : params(params)
+{
+    // Positions go to the log instead of stdout.
+    this->params.quiet = true;
+}
+
+void SimulationWorker::run()
+{
+    bool cancelled = false;
+    std::ostringstream report;
+    try {
+        Simulator simulator(params);
+        if (params.enableVTKOutput && !params.vtkOutputFile.empty()) {
+#ifdef POINTSIM_HAVE_VTK
+            VTKWriter::addSinks(simulator, params);
+#else
+            emit log("VTK output is not available in this build.");
+#endif
+        }
+        simulator.addOutputSink(std::make_unique<LogFrameSink>(simulator.outputCount(), [this](const QString& text) {
+            emit log(text);
+        }));
+        
+        const double simulationTime = (simulator.outputCount() - 1) * params.outputInterval;
+        Clock::time_point lastProgress;
+        simulator.setProgressCallback([&](const SimulationProgress& progress) {
+            const auto now = Clock::now();
+            if (progress.timeStep + 1 < progress.outputCount && now - lastProgress < minimumProgressGap) {
+                return;
+            }
+            lastProgress = now;
+            emit this->progress(progress.time, simulationTime, progress.pointStepsPerSecond, progress.remainingSeconds);
+        });
+        simulator.setCancelFlag(&cancelRequested);
+        
+        simulator.simulate(report);
+        cancelled = simulator.cancelled();
+    } catch (const std::exception& e) {
+        emit failed(QString::fromStdString(e.what()));
+        return;
+    }
+    emit finished(cancelled, QString::fromStdString(report.str()));
+}
 
 SimulationGUI::SimulationGUI(QWidget *parent)
     : QMainWindow(parent)
@@ -15,6 +130,10 @@ SimulationGUI::SimulationGUI(QWidget *parent)
 
 SimulationGUI::~SimulationGUI()
 {
+    if (worker) {
+        worker->cancel();
+    }
+    stopWorker();
 }
 
 void SimulationGUI::setupUI()
@@ -72,6 +191,23 @@ void SimulationGUI::setupUI()
     maxInitVelEdit = new QLineEdit();
     velocityLayout->addWidget(maxInitVelEdit, 3, 1);
     
+    integrationGroup = new QGroupBox("Integration");
+    QGridLayout *integrationLayout = new QGridLayout(integrationGroup);
+    integrationLayout->addWidget(new QLabel("Integrator:"), 0, 0);
+    integratorCombo = new QComboBox();
+    integratorCombo->addItems({"euler", "semi_implicit", "verlet", "rk4", "exact"});
+    integrationLayout->addWidget(integratorCombo, 0, 1);
+    integrationLayout->addWidget(new QLabel("Time Step dt (s):"), 1, 0);
+    dtEdit = new QLineEdit();
+    integrationLayout->addWidget(dtEdit, 1, 1);
+    integrationLayout->addWidget(new QLabel("Output Interval (s):"), 2, 0);
+    outputIntervalEdit = new QLineEdit();
+    integrationLayout->addWidget(outputIntervalEdit, 2, 1);
+    integrationLayout->addWidget(new QLabel("Boundary:"), 3, 0);
+    boundaryCombo = new QComboBox();
+    boundaryCombo->addItems({"none", "reflect", "periodic", "absorb"});
+    integrationLayout->addWidget(boundaryCombo, 3, 1);
+    
     outputGroup = new QGroupBox("Output Options");
     QGridLayout *outputLayout = new QGridLayout(outputGroup);
     enableVTKCheck = new QCheckBox("Enable VTK Output");
@@ -83,25 +219,40 @@ void SimulationGUI::setupUI()
     
     buttonLayout = new QHBoxLayout();
     runButton = new QPushButton("Run Simulation");
+    cancelButton = new QPushButton("Cancel");
+    cancelButton->setEnabled(false);
     resetButton = new QPushButton("Reset to Defaults");
     buttonLayout->addWidget(resetButton);
+    buttonLayout->addWidget(cancelButton);
     buttonLayout->addWidget(runButton);
     
+    progressBar = new QProgressBar();
+    progressBar->setRange(0, 1000);
+    progressBar->setValue(0);
+    progressBar->setTextVisible(false);
+    statusLabel = new QLabel();
+    
     outputText = new QTextEdit();
     outputText->setReadOnly(true);
     outputText->setMaximumHeight(150);
     outputText->setPlaceholderText("Simulation output will appear here...");
+    // Old lines are dropped, so long runs keep the widget responsive.
+    outputText->document()->setMaximumBlockCount(5000);
     
     mainLayout->addWidget(basicGroup);
     mainLayout->addWidget(frictionGroup);
     mainLayout->addWidget(forceGroup);
     mainLayout->addWidget(velocityGroup);
+    mainLayout->addWidget(integrationGroup);
     mainLayout->addWidget(outputGroup);
     mainLayout->addLayout(buttonLayout);
+    mainLayout->addWidget(progressBar);
+    mainLayout->addWidget(statusLabel);
     mainLayout->addWidget(new QLabel("Output:"));
     mainLayout->addWidget(outputText);
     
     connect(runButton, &QPushButton::clicked, this, &SimulationGUI::runSimulation);
+    connect(cancelButton, &QPushButton::clicked, this, &SimulationGUI::cancelSimulation);
     connect(resetButton, &QPushButton::clicked, this, &SimulationGUI::resetParameters);
 }
 
@@ -119,6 +270,10 @@ void SimulationGUI::setDefaultParameters()
     minInitVelEdit->setText("-0.5");
     maxInitVelEdit->setText("0.5");
     simTimeEdit->setText("10");
+    integratorCombo->setCurrentText("semi_implicit");
+    dtEdit->setText("0.01");
+    outputIntervalEdit->setText("1");
+    boundaryCombo->setCurrentText("none");
     vtkFileEdit->setText("simulation_output");
     enableVTKCheck->setChecked(false);
 }
@@ -139,6 +294,10 @@ SimulationParams SimulationGUI::getParametersFromGUI()
     params.minInitialVelocity = minInitVelEdit->text().toDouble();
     params.maxInitialVelocity = maxInitVelEdit->text().toDouble();
     params.simulationTime = simTimeEdit->text().toInt();
+    params.integrator = integratorCombo->currentText().toStdString();
+    params.dt = dtEdit->text().toDouble();
+    params.outputInterval = outputIntervalEdit->text().toDouble();
+    params.boundary = boundaryCombo->currentText().toStdString();
     params.enableVTKOutput = enableVTKCheck->isChecked();
     params.vtkOutputFile = vtkFileEdit->text().toStdString();
     
@@ -165,6 +324,12 @@ void SimulationGUI::runSimulation()
             return;
         }
         
+        if (!(params.dt > 0) || !(params.outputInterval > 0)) {
+            QMessageBox::warning(this, "Invalid Parameters",
+                "Error: dt and output interval must be positive.");
+            return;
+        }
+        
         outputText->clear();
         std::ostringstream oss;
         oss << "3D Physics Point Simulation\n";
@@ -177,33 +342,109 @@ void SimulationGUI::runSimulation()
         oss << "Velocity range: [" << params.minVelocity << ", " << params.maxVelocity << "]\n";
         oss << "Initial velocity range: [" << params.minInitialVelocity << ", " << params.maxInitialVelocity << "]\n";
         oss << "Simulation time: " << params.simulationTime << " seconds\n";
+        oss << "Integrator: " << params.integrator << ", dt " << params.dt << " s, output every "
+            << params.outputInterval << " s\n";
+        oss << "Boundary: " << params.boundary << "\n";
         if (params.enableVTKOutput) {
             oss << "VTK output file: " << params.vtkOutputFile << "\n";
         }
         oss << "\nRunning simulation...\n";
         
         outputText->setPlainText(QString::fromStdString(oss.str()));
-        QApplication::processEvents();
-        
-        runButton->setEnabled(false);
-        runButton->setText("Running...");
-        
-        Simulator simulator(params);
-        simulator.simulate();
         
-        outputText->append("Simulation completed successfully!");
+        // The simulation runs on its own thread; the UI only receives
+        // queued progress, log and completion signals.
+        worker = new SimulationWorker(params);
+        workerThread = new QThread(this);
+        worker->moveToThread(workerThread);
+        connect(workerThread, &QThread::started, worker, &SimulationWorker::run);
+        connect(workerThread, &QThread::finished, worker, &QObject::deleteLater);
+        connect(worker, &SimulationWorker::progress, this, &SimulationGUI::showProgress);
+        connect(worker, &SimulationWorker::log, this, &SimulationGUI::appendLog);
+        connect(worker, &SimulationWorker::finished, this, &SimulationGUI::simulationFinished);
+        connect(worker, &SimulationWorker::failed, this, &SimulationGUI::simulationFailed);
         
-        runButton->setEnabled(true);
-        runButton->setText("Run Simulation");
+        setRunning(true);
+        workerThread->start();
         
     } catch (const std::exception& e) {
         QMessageBox::critical(this, "Simulation Error", 
             QString("Error running simulation: %1").arg(e.what()));
-        runButton->setEnabled(true);
-        runButton->setText("Run Simulation");
+        setRunning(false);
+    }
+}
+
+void SimulationGUI::cancelSimulation()
+{
+    if (worker) {
+        worker->cancel();
+        cancelButton->setEnabled(false);
+        statusLabel->setText("Cancelling...");
+    }
+}
+
+void SimulationGUI::setRunning(bool running)
+{
+    runButton->setEnabled(!running);
+    runButton->setText(running ? "Running..." : "Run Simulation");
+    cancelButton->setEnabled(running);
+    resetButton->setEnabled(!running);
+    if (running) {
+        progressBar->setValue(0);
+        statusLabel->setText("Initializing...");
+    }
+}
+
+void SimulationGUI::stopWorker()
+{
+    if (workerThread) {
+        // run() has returned or was cancelled; the worker deletes itself
+        // once the thread's event loop ends.
+        workerThread->quit();
+        workerThread->wait();
+        delete workerThread;
+        workerThread = nullptr;
+        worker = nullptr;
+    }
+}
+
+void SimulationGUI::showProgress(double time, double simulationTime, double pointStepsPerSecond, double remainingSeconds)
+{
+    progressBar->setValue(simulationTime > 0 ? static_cast<int>(1000 * time / simulationTime) : 1000);
+    statusLabel->setText(QString("t = %1 / %2 s, %3 M point-steps/s, ETA %4 s")
+                             .arg(time, 0, 'f', 2)
+                             .arg(simulationTime, 0, 'f', 2)
+                             .arg(pointStepsPerSecond / 1e6, 0, 'f', 1)
+                             .arg(remainingSeconds, 0, 'f', 1));
+}
+
+void SimulationGUI::appendLog(const QString& text)
+{
+    outputText->append(text);
+}
+
+void SimulationGUI::simulationFinished(bool cancelled, const QString& report)
+{
+    stopWorker();
+    setRunning(false);
+    outputText->append(report.trimmed());
+    if (cancelled) {
+        statusLabel->setText("Cancelled");
+        outputText->append("Simulation cancelled.");
+    } else {
+        progressBar->setValue(1000);
+        outputText->append("Simulation completed successfully!");
     }
 }
 
+void SimulationGUI::simulationFailed(const QString& message)
+{
+    stopWorker();
+    setRunning(false);
+    statusLabel->setText("Failed");
+    QMessageBox::critical(this, "Simulation Error", QString("Error running simulation: %1").arg(message));
+}
+
 void SimulationGUI::resetParameters()
 {
     setDefaultParameters();
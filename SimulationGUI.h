@@ -12,8 +12,38 @@
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QGroupBox>
 #include <QtWidgets/QCheckBox>
+#include <QtWidgets/QComboBox>
 #include <QtWidgets/QTextEdit>
+#include <QtWidgets/QProgressBar>
+#include <QtCore/QObject>
+#include <QtCore/QThread>
 #include "Simulator.h"
+#include <atomic>
+
+// Runs one simulation on a worker thread. Progress is sent a few times per
+// second, positions go to log() as a sample of points at a limited rate, and
+// cancel() may be called from any thread.
+class SimulationWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SimulationWorker(const SimulationParams& params);
+    void cancel() { cancelRequested = true; }
+
+public slots:
+    void run();
+
+signals:
+    void progress(double time, double simulationTime, double pointStepsPerSecond, double remainingSeconds);
+    void log(const QString& text);
+    void finished(bool cancelled, const QString& report);
+    void failed(const QString& message);
+
+private:
+    SimulationParams params;
+    std::atomic<bool> cancelRequested{false};
+};
 
 class SimulationGUI : public QMainWindow
 {
@@ -25,10 +55,17 @@ public:
 
 private slots:
     void runSimulation();
+    void cancelSimulation();
     void resetParameters();
+    void showProgress(double time, double simulationTime, double pointStepsPerSecond, double remainingSeconds);
+    void appendLog(const QString& text);
+    void simulationFinished(bool cancelled, const QString& report);
+    void simulationFailed(const QString& message);
 
 private:
     void setupUI();
+    void setRunning(bool running);
+    void stopWorker();
     SimulationParams getParametersFromGUI();
     void setDefaultParameters();
 
@@ -41,6 +78,7 @@ private:
     QGroupBox *frictionGroup;
     QGroupBox *forceGroup;
     QGroupBox *velocityGroup;
+    QGroupBox *integrationGroup;
     QGroupBox *outputGroup;
     
     QLineEdit *cubeSizeEdit;
@@ -55,13 +93,23 @@ private:
     QLineEdit *minInitVelEdit;
     QLineEdit *maxInitVelEdit;
     QLineEdit *simTimeEdit;
+    QComboBox *integratorCombo;
+    QLineEdit *dtEdit;
+    QLineEdit *outputIntervalEdit;
+    QComboBox *boundaryCombo;
     QLineEdit *vtkFileEdit;
     QCheckBox *enableVTKCheck;
     
     QPushButton *runButton;
+    QPushButton *cancelButton;
     QPushButton *resetButton;
     
+    QProgressBar *progressBar;
+    QLabel *statusLabel;
     QTextEdit *outputText;
+    
+    QThread *workerThread = nullptr;
+    SimulationWorker *worker = nullptr;
 };
 
 #endif // SIMULATIONGUI_H
\ No newline at end of file
@@ -1,34 +1,327 @@
 #include "Simulator.h"
-#include "VTKWriter.h"
+#include "IntegrationKernel.h"
+#include "OutputPipeline.h"
+#include "TextFrameSink.h"
+#include "Trajectory.h"
+#include "Checkpoint.h"
+#include "Profiler.h"
+#include "CounterRng.h"
 #include <iostream>
-#include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+
+namespace {
+
+std::uint64_t randomSeed() {
+    std::random_device device;
+    return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+}
+
+Vector3D randomVector3D(CounterRng& rng, double min, double max) {
+    const double x = rng.uniform(min, max);
+    const double y = rng.uniform(min, max);
+    const double z = rng.uniform(min, max);
+    return Vector3D(x, y, z);
+}
 
-Simulator::Simulator(const SimulationParams& params) : params(params), rng(std::random_device{}()) {
-    initializeForces();
-    initializePoints();
+}
+
+Simulator::Simulator(const SimulationParams& params, ThreadPool* sharedPool)
+    : params(params), rngSeed(params.hasSeed ? params.seed : randomSeed()),
+      ownedPool(sharedPool ? nullptr : std::make_unique<ThreadPool>(static_cast<unsigned>(std::max(params.threads, 0)))),
+      pool(sharedPool ? *sharedPool : *ownedPool) {
+    KernelIsa isa;
+    if (IntegrationKernel::parseIsa(params.kernel, isa) && !IntegrationKernel::selectIsa(isa)) {
+        std::cerr << "Warning: " << IntegrationKernel::isaName(isa) << " kernel not supported by this CPU, using "
+                  << IntegrationKernel::isaName(IntegrationKernel::activeIsa()) << std::endl;
+    }
+    if (!IntegrationKernel::parseScheme(params.integrator, scheme)) {
+        std::cerr << "Warning: unknown integrator '" << params.integrator << "', using semi_implicit" << std::endl;
+    }
+    if (!IntegrationKernel::parseBoundary(params.boundary, walls.mode)) {
+        std::cerr << "Warning: unknown boundary '" << params.boundary << "', using none" << std::endl;
+    }
+    if (!IntegrationKernel::supportsBoundary(scheme, walls.mode)) {
+        std::cerr << "Warning: the exact integrator cannot " << IntegrationKernel::boundaryName(walls.mode)
+                  << " at the walls, using semi_implicit" << std::endl;
+        scheme = IntegrationScheme::SemiImplicit;
+    }
+    walls.lower = -params.cubeSize / 2.0;
+    walls.upper = params.cubeSize / 2.0;
+    if (params.interactionRadius > 0.0) {
+        if (scheme == IntegrationScheme::Exact) {
+            std::cerr << "Warning: the exact integrator does not support interactions, using semi_implicit" << std::endl;
+            scheme = IntegrationScheme::SemiImplicit;
+        }
+        const InteractionParams interaction = {params.interactionRadius, params.interactionStiffness, params.interactionDamping};
+        interactions = std::make_unique<Interactions>(interaction, walls, static_cast<std::size_t>(std::max(params.numPoints, 0)));
+    }
+    PairForceParams pair;
+    if (!BarnesHut::parseKind(params.pairForce, pair.kind)) {
+        std::cerr << "Warning: unknown pair force '" << params.pairForce << "', using none" << std::endl;
+    }
+    if (pair.kind != PairForce::None) {
+        if (scheme == IntegrationScheme::Exact) {
+            std::cerr << "Warning: the exact integrator does not support pair forces, using semi_implicit" << std::endl;
+            scheme = IntegrationScheme::SemiImplicit;
+        }
+        pair.strength = params.pairStrength;
+        pair.softening = params.pairSoftening;
+        pair.openingAngle = params.openingAngle;
+        pairForces = std::make_unique<BarnesHut>(pair);
+    }
+    if (!parsePrecision(params.precision, precision)) {
+        std::cerr << "Warning: unknown precision '" << params.precision << "', using double" << std::endl;
+    }
+    if (precision == Precision::Float && (interactions || pairForces)) {
+        std::cerr << "Warning: interactions and pair forces need double precision, using double" << std::endl;
+        precision = Precision::Double;
+    }
+    
+    // Outputs fall on whole steps, so dt is rounded to divide the interval.
+    const double interval = params.outputInterval > 0.0 ? params.outputInterval : 1.0;
+    const double dt = params.dt > 0.0 ? params.dt : 0.01;
+    this->params.outputInterval = interval;
+    stepsPerFrame = static_cast<int>(std::max(1.0, std::round(interval / dt)));
+    if (std::fabs(timeStep() - dt) > 1e-9 * dt && scheme != IntegrationScheme::Exact) {
+        std::cerr << "Warning: dt adjusted to " << timeStep() << " to divide the output interval" << std::endl;
+    }
+    if ((walls.mode == BoundaryMode::Reflect || walls.mode == BoundaryMode::Periodic) &&
+        params.maxVelocity * timeStep() > params.cubeSize) {
+        std::cerr << "Warning: maxVelocity * dt exceeds the cube size; points can cross more than one wall per step" << std::endl;
+    }
+    ForceMode forceMode;
+    if (!parseForceMode(params.forceMode, forceMode)) {
+        std::cerr << "Warning: unknown force mode '" << params.forceMode << "', using constant" << std::endl;
+        forceMode = ForceMode::Constant;
+    }
+    if (forceMode == ForceMode::PerStep) {
+        const double resample = params.forceResampleInterval > 0.0 ? params.forceResampleInterval : timeStep();
+        resampleSteps = static_cast<int>(std::max(1.0, std::round(resample / timeStep())));
+        if (std::fabs(resampleSteps * timeStep() - resample) > 1e-9 * resample) {
+            std::cerr << "Warning: force resample interval adjusted to " << resampleSteps * timeStep()
+                      << " to a whole number of steps" << std::endl;
+        }
+    }
+    frames = static_cast<int>(std::floor(std::max(params.simulationTime, 0) / interval + 1e-9)) + 1;
+    
+    if (params.profile) {
+#ifdef POINTSIM_NO_PROFILER
+        std::cerr << "Warning: built without the profiler, ignoring profile request" << std::endl;
+#else
+        Profiler::enable(static_cast<std::size_t>(std::max(params.numPoints, 0)), frames);
+#endif
+    }
+    if (params.resume) {
+        restoreCheckpoint();
+    } else {
+        initializeForces();
+        initializePoints();
+    }
+    
+    // Drawn after a resume so the sample follows the checkpoint's seed.
+    if (params.subsample > 0 && params.subsample < params.numPoints) {
+        if (params.checkpointInterval > 0.0 || !params.trajectoryFile.empty()) {
+            std::cerr << "Warning: checkpoints and trajectories need every point, ignoring subsample" << std::endl;
+        } else {
+            subsample = std::make_unique<StratifiedSample>(static_cast<std::size_t>(params.numPoints),
+                                                          static_cast<std::size_t>(params.subsample), rngSeed);
+        }
+    }
+}
+
+void Simulator::restoreCheckpoint() {
+    ProfileScope profile(ProfilePhase::Init, -1);
+    const CheckpointReader checkpoint(params.checkpointFile);
+    const CheckpointHeader& header = checkpoint.header();
+    if (header.numPoints != static_cast<std::uint64_t>(std::max(params.numPoints, 0)) ||
+        header.numForces != static_cast<std::uint32_t>(std::max(params.numForces, 0)) ||
+        header.stepsPerOutput != stepsPerFrame || header.resampleSteps != resampleSteps ||
+        header.scheme != static_cast<std::int32_t>(scheme) || header.boundary != static_cast<std::int32_t>(walls.mode)) {
+        throw std::runtime_error("Checkpoint " + params.checkpointFile + " was written by a different configuration");
+    }
+    if (params.hasSeed && params.seed != header.seed) {
+        std::cerr << "Warning: using the checkpoint's seed " << header.seed << std::endl;
+    }
+    rngSeed = header.seed;
+    forces = checkpoint.forces();
+    
+    const ParticleLimits limits = {params.minVelocity, params.maxVelocity, params.minAcceleration, params.maxAcceleration};
+    if (precision == Precision::Float) {
+        points.clear();
+        checkpoint.readPoints(floatPoints);
+        floatPoints.limits = limits;
+    } else {
+        floatPoints.clear();
+        checkpoint.readPoints(points);
+        points.limits = limits;
+    }
+    firstFrame = static_cast<int>(header.timeStep) + 1;
+    profile.add(0, header.count);
 }
 
 void Simulator::initializePoints() {
-    points.clear();
-    points.reserve(params.numPoints);
-    
-    for (int i = 0; i < params.numPoints; ++i) {
-        Vector3D position = randomVector3D(-params.cubeSize / 2.0, params.cubeSize / 2.0);
-        Vector3D initialVelocity = randomVector3D(params.minInitialVelocity, params.maxInitialVelocity);
-        Vector3D acceleration(0.0, 0.0, 0.0); // Start with zero acceleration, forces will set it
-        double friction = randomDouble(params.minFriction, params.maxFriction);
+    ProfileScope profile(ProfilePhase::Init, -1);
+    profile.add(0, static_cast<std::size_t>(std::max(params.numPoints, 0)));
+    if (precision == Precision::Float) {
+        points.clear();
+        initializeStore(floatPoints);
+    } else {
+        floatPoints.clear();
+        initializeStore(points);
+    }
+}
+
+template <typename Scalar>
+void Simulator::initializeStore(BasicParticleStore<Scalar>& store) {
+    const std::size_t n = static_cast<std::size_t>(std::max(params.numPoints, 0));
+    
+    store.clear();
+    store.resize(n);
+    store.limits = {params.minVelocity, params.maxVelocity, params.minAcceleration, params.maxAcceleration};
+    
+    const double half = params.cubeSize / 2.0;
+    
+    // Each point draws from its own (seed, stream, index) sequences, so the
+    // result depends only on the seed, not on how the range is chunked.
+    // Random numbers are generated a chunk at a time straight into the
+    // arrays, mapped to their ranges in place, and the summed force is
+    // clamped once per point. Float stores get the same doubles, staged in
+    // the scratch buffer and rounded once.
+    constexpr bool staged = !std::is_same<Scalar, double>::value;
+    AlignedVector<Scalar>* components[7] = {
+        &store.px, &store.py, &store.pz, &store.vx, &store.vy, &store.vz, &store.friction
+    };
+    pool.parallelFor(n, ThreadPool::cacheGrain(BasicParticleStore<Scalar>::bytesPerPoint), [&](std::size_t begin, std::size_t end) {
+        const std::size_t count = end - begin;
+        std::vector<double> scratch((staged ? 9 : 2) * count);
+        double* first = scratch.data();
+        double* second = first + count;
+        double* target[7];
+        for (std::size_t c = 0; c < 7; ++c) {
+            if constexpr (staged) {
+                target[c] = second + (c + 1) * count;
+            } else {
+                target[c] = components[c]->data() + begin;
+            }
+        }
+        
+        double* px = target[0];
+        double* py = target[1];
+        double* pz = target[2];
+        double* vx = target[3];
+        double* vy = target[4];
+        double* vz = target[5];
+        double* friction = target[6];
         
-        Point point(position, initialVelocity, acceleration, friction);
-        point.initialVelocity = initialVelocity;
-        point.setVelocityLimits(params.minVelocity, params.maxVelocity);
-        point.setAccelerationLimits(params.minAcceleration, params.maxAcceleration);
+        CounterRng::uniformPairs(rngSeed, RngStream::Position, begin, count, 0, px, py);
+        CounterRng::uniformPairs(rngSeed, RngStream::Position, begin, count, 1, pz, first);
+        CounterRng::uniformPairs(rngSeed, RngStream::Velocity, begin, count, 0, vx, vy);
+        CounterRng::uniformPairs(rngSeed, RngStream::Velocity, begin, count, 1, vz, first);
+        CounterRng::uniformPairs(rngSeed, RngStream::Friction, begin, count, 0, friction, first);
         
-        for (const auto& force : forces) {
-            Vector3D forceVector = force.generateForce(rng);
-            point.applyForce(forceVector);
+        // Locals, so the stores below cannot alias the parameters.
+        const double positionRange = params.cubeSize;
+        const double minVelocity = params.minInitialVelocity;
+        const double velocityRange = params.maxInitialVelocity - params.minInitialVelocity;
+        const double minFriction = params.minFriction;
+        const double frictionRange = params.maxFriction - params.minFriction;
+        for (std::size_t i = 0; i < count; ++i) {
+            px[i] = -half + positionRange * px[i];
+            py[i] = -half + positionRange * py[i];
+            pz[i] = -half + positionRange * pz[i];
+            vx[i] = minVelocity + velocityRange * vx[i];
+            vy[i] = minVelocity + velocityRange * vy[i];
+            vz[i] = minVelocity + velocityRange * vz[i];
+            friction[i] = minFriction + frictionRange * friction[i];
+        }
+        if constexpr (staged) {
+            for (std::size_t c = 0; c < 7; ++c) {
+                Scalar* out = components[c]->data() + begin;
+                for (std::size_t i = 0; i < count; ++i) {
+                    out[i] = static_cast<Scalar>(target[c][i]);
+                }
+            }
         }
         
-        points.push_back(point);
+        sampleAccelerations(store, begin, count, 0, scratch);
+    });
+}
+
+template <typename Scalar>
+void Simulator::sampleAccelerations(BasicParticleStore<Scalar>& store, std::size_t begin, std::size_t count,
+                                    std::uint64_t sample, std::vector<double>& scratch) {
+    // Float stores get the sums staged in doubles and rounded once.
+    constexpr bool staged = !std::is_same<Scalar, double>::value;
+    const std::size_t numForces = forces.size();
+    // Draws are made and summed in chunks whose draws stay in L1, with room
+    // for four draws per Philox block, the most either layout uses.
+    const std::size_t rows = (numForces + 3) / 4 * 4;
+    const std::size_t chunk = std::min<std::size_t>(count, 512);
+    scratch.resize(5 * numForces + rows * chunk + (staged ? 3 * count : 0));
+    double* terms = scratch.data();
+    double* draws = terms + 5 * numForces;
+    for (std::size_t f = 0; f < numForces; ++f) {
+        const Force& force = forces[f];
+        double* term = terms + 5 * f;
+        term[0] = force.direction.x;
+        term[1] = force.direction.y;
+        term[2] = force.direction.z;
+        term[3] = force.minMagnitude;
+        term[4] = force.maxMagnitude - force.minMagnitude;
+    }
+    
+    double* ax = draws + rows * chunk;
+    double* ay = ax + count;
+    double* az = ay + count;
+    if constexpr (!staged) {
+        ax = store.ax.data() + begin;
+        ay = store.ay.data() + begin;
+        az = store.az.data() + begin;
+    }
+    
+    // Sample s of point i uses the index i + s * 2^32, so sample 0 is the
+    // initial draw and every later one is independent of it. Points are keyed
+    // by their original index, so removing or reordering points does not
+    // change the draws of the rest. The initial draw, shared with constant
+    // forces, takes two 52-bit magnitudes per Philox block; per-step redraws
+    // take four 32-bit ones, halving the blocks per point.
+    const std::uint64_t sampleIndex = sample << 32;
+    const std::size_t perBlock = sample == 0 ? 2 : 4;
+    for (std::size_t at = 0; at < count; at += chunk) {
+        const std::size_t n = std::min(chunk, count - at);
+        const std::uint32_t* ids = store.indexed ? store.ids.data() + begin + at : nullptr;
+        for (std::size_t b = 0; b * perBlock < numForces; ++b) {
+            const std::uint32_t block = static_cast<std::uint32_t>(b);
+            double* out = draws + perBlock * b * n;
+            if (perBlock == 2 && !ids) {
+                CounterRng::uniformPairs(rngSeed, RngStream::PointForce, sampleIndex + begin + at, n, block, out, out + n);
+            } else if (perBlock == 2) {
+                CounterRng::uniformPairsAt(rngSeed, RngStream::PointForce, sampleIndex, ids, n, block, out, out + n);
+            } else if (!ids) {
+                CounterRng::uniformQuads(rngSeed, RngStream::PointForce, sampleIndex + begin + at, n, block,
+                                         out, out + n, out + 2 * n, out + 3 * n);
+            } else {
+                CounterRng::uniformQuadsAt(rngSeed, RngStream::PointForce, sampleIndex, ids, n, block,
+                                           out, out + n, out + 2 * n, out + 3 * n);
+            }
+        }
+        IntegrationKernel::sumForces(terms, numForces, draws, n, params.minAcceleration, params.maxAcceleration, staged,
+                                     ax + at, ay + at, az + at);
+    }
+    if constexpr (staged) {
+        for (std::size_t i = 0; i < count; ++i) {
+            store.ax[begin + i] = static_cast<Scalar>(ax[i]);
+            store.ay[begin + i] = static_cast<Scalar>(ay[i]);
+            store.az[begin + i] = static_cast<Scalar>(az[i]);
+        }
     }
 }
 
@@ -37,70 +330,309 @@ void Simulator::initializeForces() {
     forces.reserve(params.numForces);
     
     for (int i = 0; i < params.numForces; ++i) {
-        Vector3D direction = randomVector3D(-1.0, 1.0).normalized();
-        double minMag = randomDouble(params.minAcceleration, params.maxAcceleration);
-        double maxMag = minMag + randomDouble(0.0, params.maxAcceleration - minMag);
+        CounterRng rng(rngSeed, RngStream::Force, static_cast<std::uint64_t>(i));
+        Vector3D direction = randomVector3D(rng, -1.0, 1.0).normalized();
+        double minMag = rng.uniform(params.minAcceleration, params.maxAcceleration);
+        double maxMag = minMag + rng.uniform(0.0, params.maxAcceleration - minMag);
         
         forces.emplace_back(direction, minMag, maxMag);
     }
 }
 
+bool Simulator::parsePrecision(const std::string& name, Precision& precision) {
+    if (name == "double") {
+        precision = Precision::Double;
+    } else if (name == "float") {
+        precision = Precision::Float;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool Simulator::parseSeed(const std::string& text, std::uint64_t& seed) {
+    if (text.empty() || !std::all_of(text.begin(), text.end(), [](unsigned char ch) { return std::isdigit(ch); })) {
+        return false;
+    }
+    try {
+        seed = std::stoull(text);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+const char* Simulator::precisionName(Precision precision) {
+    return precision == Precision::Float ? "float" : "double";
+}
+
+bool Simulator::parseForceMode(const std::string& name, ForceMode& mode) {
+    if (name == "constant") {
+        mode = ForceMode::Constant;
+    } else if (name == "per_step") {
+        mode = ForceMode::PerStep;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int Simulator::integrationRuns(int timeStep) const {
+    // Resample boundaries inside the output interval, plus the first run.
+    if (resampleSteps == 0) {
+        return 1;
+    }
+    const std::uint64_t first = static_cast<std::uint64_t>(timeStep) * stepsPerFrame;
+    const std::uint64_t last = first + stepsPerFrame - 1;
+    return static_cast<int>(last / resampleSteps - first / resampleSteps) + 1;
+}
+
+void Simulator::addOutputSink(std::unique_ptr<FrameSink> sink) {
+    outputSinks.push_back(std::move(sink));
+}
+
+bool Simulator::writesGrid() const {
+    return std::any_of(outputSinks.begin(), outputSinks.end(), [](const std::unique_ptr<FrameSink>& sink) {
+        return sink->wantsGrid();
+    });
+}
+
 void Simulator::simulate() {
-    std::cout << std::fixed << std::setprecision(3);
+    simulate(std::cerr);
+}
+
+void Simulator::simulate(std::ostream& report) {
+    OutputPipeline output(static_cast<std::size_t>(std::max(params.outputQueueDepth, 1)),
+                          static_cast<unsigned>(std::max(params.outputThreads, 1)));
+    if (!params.quiet) {
+        TextOutputOptions textOptions;
+        TextFrameSink::parseFormat(params.outputFormat, textOptions.format);
+        textOptions.pointStride = params.printPointStride;
+        textOptions.timeStride = params.printTimeStride;
+        if (params.textOutputFile.empty()) {
+            output.addSink(std::make_unique<TextFrameSink>(STDOUT_FILENO, textOptions));
+        } else {
+            output.addSink(TextFrameSink::openFile(params.textOutputFile, textOptions));
+        }
+    }
     
-    if (params.enableVTKOutput) {
-        pointsHistory.clear();
-        pointsHistory.reserve(params.simulationTime + 1);
+    voxels.reset();
+    if (params.voxelGrid > 0) {
+        if (writesGrid()) {
+            voxels = std::make_unique<VoxelBinner>(params.voxelGrid, walls.lower, walls.upper);
+        } else {
+            std::cerr << "Warning: voxel_grid needs VTK output (vtk_output_file), ignoring it" << std::endl;
+        }
     }
+    for (auto& sink : outputSinks) {
+        output.addSink(std::move(sink));
+    }
+    outputSinks.clear();
     
-    const double dt = 0.01;
-    const int stepsPerSecond = static_cast<int>(1.0 / dt);
+    if (!params.trajectoryFile.empty()) {
+        TrajectoryOptions options;
+        options.float32 = params.trajectoryFloat32;
+        options.delta = params.trajectoryDelta;
+        options.accelerations = resampleSteps > 0;
+        options.keyframeInterval = static_cast<std::uint32_t>(std::max(params.trajectoryKeyframeInterval, 1));
+        output.addSink(std::make_unique<TrajectoryWriter>(params.trajectoryFile, params, rngSeed, options));
+    }
     
-    for (int t = 0; t <= params.simulationTime; ++t) {
-        std::cout << "Time: " << t << " seconds\n";
-        std::cout << "====================\n";
-        
-        for (int step = 0; step < stepsPerSecond; ++step) {
-            for (size_t i = 0; i < points.size(); ++i) {
-                points[i].update(dt);
-            }
+    if (params.checkpointInterval > 0.0) {
+        CheckpointHeader run = {};
+        run.seed = rngSeed;
+        run.numPoints = static_cast<std::uint64_t>(std::max(params.numPoints, 0));
+        run.stepsPerOutput = stepsPerFrame;
+        run.resampleSteps = resampleSteps;
+        run.scheme = static_cast<std::int32_t>(scheme);
+        run.boundary = static_cast<std::int32_t>(walls.mode);
+        const int every = static_cast<int>(std::max(1.0, std::round(params.checkpointInterval / params.outputInterval)));
+        output.addSink(std::make_unique<CheckpointWriter>(params.checkpointFile, every, run, forces));
+    }
+    
+    absorbedPoints = precision == Precision::Float ? run(floatPoints, output) : run(points, output);
+    
+    output.finish();
+    
+    std::cout.flush();
+    output.printReport(report);
+    if (cancelled()) {
+        report << "Cancelled before the output at " << cancelledFrame * params.outputInterval << " s" << std::endl;
+    }
+    if (walls.mode == BoundaryMode::Absorb) {
+        report << "Absorbed points: " << absorbedPoints << " of " << (absorbedPoints + pointCount()) << std::endl;
+    }
+    if (pairForces) {
+        report << "Octree: " << pairForces->buildCount() << " builds, " << pairForces->refitCount() << " refits" << std::endl;
+    }
+    
+    if (Profiler::enabled()) {
+        if (Profiler::writeReport(params.profileOutput)) {
+            report << "Profile written to: " << params.profileOutput << std::endl;
         }
+        Profiler::disable();
+    }
+}
+
+template <typename Scalar>
+std::size_t Simulator::run(BasicParticleStore<Scalar>& store, OutputPipeline& output) {
+    const double dt = timeStep();
+    const int steps = stepsPerFrame;
+    // Non-zero only for a resumed run that had already absorbed points.
+    std::size_t absorbed = static_cast<std::size_t>(std::max(params.numPoints, 0)) - store.size();
+    const std::size_t grain = ThreadPool::cacheGrain(BasicParticleStore<Scalar>::bytesPerPoint);
+    
+    using Clock = std::chrono::steady_clock;
+    const auto runStart = Clock::now();
+    double pointSteps = 0.0;
+    
+    for (int t = firstFrame; t < frames; ++t) {
+        const auto computeStart = Clock::now();
         
-        if (params.enableVTKOutput) {
-            pointsHistory.push_back(points);
+        if (interactions || pairForces) {
+            advanceCoupled(t);
+        } else {
+            // Points are independent, so each chunk runs all steps of the
+            // output interval while it is hot in cache; the result does not
+            // depend on how the range is split across threads.
+            ProfileScope integrate(ProfilePhase::Integrate, t);
+            pool.parallelFor(store.size(), grain, [&](std::size_t begin, std::size_t end) {
+                // Cancelling skips the blocks not yet started.
+                if (resampleSteps == 0) {
+                    for (std::size_t block = begin; block < end && !cancelRequested(); block += grain) {
+                        IntegrationKernel::integrate(store, block, std::min(end, block + grain), dt, steps, scheme, walls);
+                    }
+                    return;
+                }
+                // Per-step forces: each cache-sized block draws new
+                // magnitudes into this thread's buffers and integrates up to
+                // the next resample, all steps while it stays in cache.
+                std::vector<double> scratch;
+                for (std::size_t block = begin; block < end && !cancelRequested(); block += grain) {
+                    const std::size_t blockEnd = std::min(end, block + grain);
+                    const std::size_t count = blockEnd - block;
+                    for (int step = 0; step < steps;) {
+                        const std::uint64_t global = static_cast<std::uint64_t>(t) * steps + step;
+                        if (global > 0 && global % resampleSteps == 0) {
+                            sampleAccelerations(store, block, count, global / resampleSteps, scratch);
+                        }
+                        const int segment = static_cast<int>(std::min<std::uint64_t>(steps - step, resampleSteps - global % resampleSteps));
+                        IntegrationKernel::integrate(store, block, blockEnd, dt, segment, scheme, walls);
+                        step += segment;
+                    }
+                }
+            });
+            integrate.add(0, store.size() * (scheme == IntegrationScheme::Exact ? integrationRuns(t) : steps));
+        }
+        if (cancelRequested()) {
+            cancelledFrame = t;
+            break;
+        }
+        // Absorbed points are dropped once per output interval, so the
+        // following intervals only integrate the points still inside.
+        if (walls.mode == BoundaryMode::Absorb) {
+            absorbed += store.removeAbsorbed();
         }
         
-        printPointPositions(t);
+        const auto snapshotStart = Clock::now();
+        output.recordCompute(std::chrono::duration<double>(snapshotStart - computeStart).count());
         
-        if (params.enableVTKOutput && !params.vtkOutputFile.empty()) {
-            VTKWriter::writePoints(points, params.vtkOutputFile, t);
+        // The writers serialize this snapshot while the next interval is
+        // being integrated.
+        if (output.wantsFrame(t)) {
+            ProfileScope stall(ProfilePhase::Stall, t);
+            Frame& frame = output.acquire();
+            stall.stop();
+            
+            if (voxels) {
+                ProfileScope voxel(ProfilePhase::VoxelGrid, t);
+                voxels->bin(store, pool, frame.grid);
+                voxel.add(frame.grid.cellCount() * (sizeof(std::uint32_t) + 4 * sizeof(float)), store.size());
+            }
+            
+            ProfileScope snapshot(ProfilePhase::Snapshot, t);
+            frame.timeStep = t;
+            frame.time = t * params.outputInterval;
+            frame.precision = precision;
+            BasicParticleStore<Scalar>& copy = frame.store<Scalar>();
+            if (subsample) {
+                subsample->select(store, copy);
+            } else {
+                copy = store;
+            }
+            snapshot.add(copy.size() * BasicParticleStore<Scalar>::bytesPerPoint, copy.size());
+            snapshot.stop();
+            output.submit(frame);
         }
         
-        std::cout << "\n";
+        output.recordSnapshot(std::chrono::duration<double>(Clock::now() - snapshotStart).count());
+        
+        if (progressCallback) {
+            const int done = t - firstFrame + 1;
+            SimulationProgress progress;
+            progress.timeStep = t;
+            progress.outputCount = frames;
+            progress.time = t * params.outputInterval;
+            progress.points = store.size();
+            progress.elapsedSeconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+            pointSteps += static_cast<double>(store.size()) * steps;
+            progress.pointStepsPerSecond = progress.elapsedSeconds > 0.0 ? pointSteps / progress.elapsedSeconds : 0.0;
+            progress.remainingSeconds = progress.elapsedSeconds / done * (frames - 1 - t);
+            progressCallback(progress);
+        }
     }
     
-    if (params.enableVTKOutput && !params.vtkOutputFile.empty()) {
-        VTKWriter::writeTimeSeriesPoints(pointsHistory, params.vtkOutputFile);
-    }
+    return absorbed;
 }
 
-void Simulator::printPointPositions(int) const {
-    for (size_t i = 0; i < points.size(); ++i) {
-        const auto& pos = points[i].position;
-        std::cout << "Point " << i << ": (" 
-                  << pos.x << ", " << pos.y << ", " << pos.z << ")\n";
+void Simulator::advanceCoupled(int t) {
+    const double dt = timeStep();
+    const int steps = stepsPerFrame;
+    const std::size_t grain = ThreadPool::cacheGrain(ParticleStore::bytesPerPoint);
+    
+    // Contact and pair forces depend on the other points, so all
+    // points advance one step at a time with the forces of the
+    // current positions.
+    for (int step = 0; step < steps && !cancelRequested(); ++step) {
+        const std::uint64_t global = static_cast<std::uint64_t>(t) * steps + step;
+        if (resampleSteps > 0 && global > 0 && global % resampleSteps == 0) {
+            ProfileScope resample(ProfilePhase::Integrate, t);
+            pool.parallelFor(points.size(), grain, [&](std::size_t begin, std::size_t end) {
+                std::vector<double> scratch;
+                sampleAccelerations(points, begin, end - begin, global / resampleSteps, scratch);
+            });
+        }
+        AccelerationField field = {points.ax.data(), points.ay.data(), points.az.data()};
+        if (interactions) {
+            ProfileScope interact(ProfilePhase::Interactions, t);
+            interactions->update(points, pool, field);
+            field = interactions->field();
+            interact.add(0, points.size());
+        }
+        if (pairForces) {
+            ProfileScope pair(ProfilePhase::PairForces, t);
+            pairForces->update(points, pool, field);
+            field = pairForces->field();
+            pair.add(0, points.size());
+        }
+        
+        ProfileScope integrate(ProfilePhase::Integrate, t);
+        pool.parallelFor(points.size(), grain, [&](std::size_t begin, std::size_t end) {
+            IntegrationKernel::integrate(points, begin, end, dt, 1, scheme, walls, &field);
+        });
+        integrate.add(0, points.size());
+    }
+    // Keep the store in Morton order, so points that interact also
+    // sit close together in memory.
+    points.permute(interactions ? interactions->order() : pairForces->order());
+    if (pairForces) {
+        pairForces->invalidate();
     }
 }
 
-double Simulator::randomDouble(double min, double max) {
-    std::uniform_real_distribution<double> dis(min, max);
-    return dis(rng);
+void Simulator::printPointPositions(int) const {
+    std::string text;
+    const std::size_t length = precision == Precision::Float ? TextFrameSink::formatPoints(floatPoints, 1, text, 0)
+                                                             : TextFrameSink::formatPoints(points, 1, text, 0);
+    std::cout.write(text.data(), static_cast<std::streamsize>(length));
 }
-
-Vector3D Simulator::randomVector3D(double min, double max) {
-    return Vector3D(
-        randomDouble(min, max),
-        randomDouble(min, max),
-        randomDouble(min, max)
-    );
-}
\ No newline at end of file
@@ -1,8 +1,25 @@
 #pragma once
 #include "Point.h"
 #include "Force.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include "OutputPipeline.h"
+#include "IntegrationKernel.h"
+#include "Interactions.h"
+#include "BarnesHut.h"
+#include "VoxelGrid.h"
+#include "Subsample.h"
 #include <vector>
-#include <random>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+
+// Constant draws each point's force magnitudes once; PerStep redraws them
+// every force resample interval.
+enum class ForceMode { Constant, PerStep };
 
 struct SimulationParams {
     double cubeSize;
@@ -17,27 +34,171 @@ struct SimulationParams {
     double minInitialVelocity;
     double maxInitialVelocity;
     int simulationTime;
+    double dt = 0.01;
+    double outputInterval = 1.0;
+    std::string forceMode = "constant";
+    // Simulated time between force draws with per_step; 0 means every step.
+    double forceResampleInterval = 0.0;
+    std::string precision = "double";
     std::string vtkOutputFile;
     bool enableVTKOutput;
+    // Pieces per VTK frame; 0 means one per hardware thread.
+    int vtkPieces = 1;
+    std::string vtkEncoding = "base64";
+    std::string vtkCompression = "zlib";
+    int vtkCompressionLevel = 5;
+    std::string kernel = "auto";
+    std::string integrator = "semi_implicit";
+    std::string boundary = "none";
+    double interactionRadius = 0.0;
+    double interactionStiffness = 0.0;
+    double interactionDamping = 0.0;
+    std::string pairForce = "none";
+    double pairStrength = 1.0;
+    double pairSoftening = 0.1;
+    double openingAngle = 0.5;
+    int threads = 0;
+    int outputQueueDepth = 2;
+    int outputThreads = 1;
+    std::string trajectoryFile;
+    bool trajectoryFloat32 = false;
+    bool trajectoryDelta = false;
+    int trajectoryKeyframeInterval = 32;
+    bool quiet = false;
+    int printPointStride = 1;
+    int printTimeStride = 1;
+    std::string outputFormat = "text";
+    // Positions go to this file instead of stdout when set.
+    std::string textOutputFile;
+    // Prepended to the output file names of each run of a sweep.
+    std::string outputPrefix;
+    bool profile = false;
+    std::string profileOutput = "pointsim_profile.json";
+    // Simulated time between checkpoints; 0 disables them.
+    double checkpointInterval = 0.0;
+    std::string checkpointFile = "pointsim_checkpoint.bin";
+    // Continue from checkpointFile instead of drawing new points.
+    bool resume = false;
+    // Cells per axis of the per-frame density grid; 0 disables it.
+    int voxelGrid = 0;
+    // Points per frame in the output; 0 writes every point.
+    int subsample = 0;
+    bool hasSeed = false;
+    std::uint64_t seed = 0;
+};
+
+// Reported after every output interval of simulate().
+struct SimulationProgress {
+    int timeStep;
+    int outputCount;
+    // Simulated time reached, in seconds.
+    double time;
+    std::size_t points;
+    double elapsedSeconds;
+    double pointStepsPerSecond;
+    // Estimated wall time until the last output interval is done.
+    double remainingSeconds;
 };
 
 class Simulator {
+public:
+    using ProgressCallback = std::function<void(const SimulationProgress& progress)>;
+    
 private:
-    std::vector<Point> points;
+    // Only the store matching `precision` holds the points.
+    Precision precision = Precision::Double;
+    ParticleStore points;
+    FloatParticleStore floatPoints;
     std::vector<Force> forces;
-    std::vector<std::vector<Point>> pointsHistory;
     SimulationParams params;
-    std::mt19937 rng;
+    std::uint64_t rngSeed;
+    IntegrationScheme scheme = IntegrationScheme::SemiImplicit;
+    Walls walls;
+    std::unique_ptr<Interactions> interactions;
+    std::unique_ptr<BarnesHut> pairForces;
+    // Reduced output; voxels exists only during a simulate() with a grid
+    // output, subsample only with subsample set.
+    std::unique_ptr<VoxelBinner> voxels;
+    std::unique_ptr<StratifiedSample> subsample;
+    int stepsPerFrame;
+    // Steps between force draws; 0 keeps the initial forces.
+    int resampleSteps = 0;
+    int frames;
+    // First output time to run; after the checkpoint's one when resuming.
+    int firstFrame = 0;
+    std::size_t absorbedPoints = 0;
+    ProgressCallback progressCallback;
+    const std::atomic<bool>* cancelFlag = nullptr;
+    // Output time whose interval was interrupted, or -1.
+    int cancelledFrame = -1;
+    std::unique_ptr<ThreadPool> ownedPool;
+    ThreadPool& pool;
+    std::vector<std::unique_ptr<FrameSink>> outputSinks;
     
 public:
-    Simulator(const SimulationParams& params);
+    // Runs on sharedPool when given, otherwise on its own pool of
+    // params.threads threads.
+    explicit Simulator(const SimulationParams& params, ThreadPool* sharedPool = nullptr);
     
     void initializePoints();
     void initializeForces();
+    static bool parseForceMode(const std::string& name, ForceMode& mode);
+    static bool parsePrecision(const std::string& name, Precision& precision);
+    // Digits only: no sign, so "-1" does not wrap, and nothing after them.
+    static bool parseSeed(const std::string& text, std::uint64_t& seed);
+    static const char* precisionName(Precision precision);
+    // Registers an additional output (e.g. VTK) for the next simulate() call.
+    void addOutputSink(std::unique_ptr<FrameSink> sink);
+    // Whether a registered output takes the voxel grid; frames are only
+    // binned then.
+    bool writesGrid() const;
+    // Called on the simulating thread after every output interval.
+    void setProgressCallback(ProgressCallback callback) { progressCallback = std::move(callback); }
+    // Once *flag becomes true, simulate() stops at the next step (or chunk of
+    // points) and returns; the interrupted output interval is not written.
+    void setCancelFlag(const std::atomic<bool>* flag) { cancelFlag = flag; }
+    bool cancelled() const { return cancelledFrame >= 0; }
     void simulate();
+    // As simulate(), with the end-of-run reports written to `report`.
+    void simulate(std::ostream& report);
     void printPointPositions(int timeStep) const;
+    unsigned threadCount() const { return pool.size(); }
+    // Output times are 0, outputInterval, ... up to simulationTime, with
+    // stepsPerOutput() steps of timeStep() between two of them.
+    IntegrationScheme integrationScheme() const { return scheme; }
+    Precision scalarPrecision() const { return precision; }
+    std::size_t pointCount() const { return precision == Precision::Float ? floatPoints.size() : points.size(); }
+    BoundaryMode boundaryMode() const { return walls.mode; }
+    bool hasInteractions() const { return interactions != nullptr; }
+    bool hasPairForces() const { return pairForces != nullptr; }
+    int outputCount() const { return frames; }
+    int stepsPerOutput() const { return stepsPerFrame; }
+    double timeStep() const { return params.outputInterval / stepsPerFrame; }
+    std::uint64_t seed() const { return rngSeed; }
+    int forceResampleSteps() const { return resampleSteps; }
+    // Points removed by absorbing walls during the last simulate().
+    std::size_t absorbedCount() const { return absorbedPoints; }
+    // Simulated time of the checkpoint the run resumed from, or -1.
+    double resumedTime() const { return firstFrame > 0 ? (firstFrame - 1) * params.outputInterval : -1.0; }
+    // Points per output frame with subsample set, otherwise 0.
+    std::size_t sampleSize() const { return subsample ? subsample->size() : 0; }
     
 private:
-    double randomDouble(double min, double max);
-    Vector3D randomVector3D(double min, double max);
+    // Loads forces, points and seed from params.checkpointFile; throws if it
+    // was written by a different configuration.
+    void restoreCheckpoint();
+    template <typename Scalar>
+    void initializeStore(BasicParticleStore<Scalar>& store);
+    // Sums and clamps draw `sample` of every force into the accelerations of
+    // points [begin, begin + count); scratch is resized to hold the draws.
+    template <typename Scalar>
+    void sampleAccelerations(BasicParticleStore<Scalar>& store, std::size_t begin, std::size_t count, std::uint64_t sample,
+                             std::vector<double>& scratch);
+    // Runs every output interval on `store`; returns the number of absorbed points.
+    template <typename Scalar>
+    std::size_t run(BasicParticleStore<Scalar>& store, OutputPipeline& output);
+    // One output interval with interactions or pair forces (double only).
+    void advanceCoupled(int timeStep);
+    bool cancelRequested() const { return cancelFlag && cancelFlag->load(std::memory_order_relaxed); }
+    int integrationRuns(int timeStep) const;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "Subsample.h"
+#include "CounterRng.h"
+#include <algorithm>
+
+namespace {
+const std::size_t missing = static_cast<std::size_t>(-1);
+}
+
+StratifiedSample::StratifiedSample(std::size_t numPoints, std::size_t k, std::uint64_t seed)
+    : total(numPoints) {
+    k = std::min(k, numPoints);
+    chosen.resize(k);
+    for (std::size_t s = 0; s < k; ++s) {
+        const std::uint64_t first = s * total / k;
+        const std::uint64_t size = (s + 1) * total / k - first;
+        CounterRng rng(seed, RngStream::Sample, s);
+        const std::uint64_t offset = std::min(static_cast<std::uint64_t>(rng.uniform() * size), size - 1);
+        chosen[s] = static_cast<std::uint32_t>(first + offset);
+    }
+}
+
+// Stratum s holds the indices [s * total / k, (s + 1) * total / k).
+std::size_t StratifiedSample::stratum(std::uint32_t id) const {
+    return static_cast<std::size_t>(((static_cast<std::uint64_t>(id) + 1) * chosen.size() - 1) / total);
+}
+
+template <typename Scalar>
+void StratifiedSample::select(const BasicParticleStore<Scalar>& points, BasicParticleStore<Scalar>& sample) {
+    const std::size_t n = points.size();
+    positions.assign(chosen.size(), missing);
+    if (!points.indexed) {
+        for (std::size_t s = 0; s < chosen.size(); ++s) {
+            if (chosen[s] < n) {
+                positions[s] = chosen[s];
+            }
+        }
+    } else {
+        // Points were removed or reordered: look each one up by its stratum.
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::uint32_t id = points.ids[i];
+            if (id < total && chosen[stratum(id)] == id) {
+                positions[stratum(id)] = i;
+            }
+        }
+    }
+
+    const std::size_t count = static_cast<std::size_t>(std::count_if(positions.begin(), positions.end(), [](std::size_t position) {
+        return position != missing;
+    }));
+    sample.indexed = true;
+    sample.resize(count);
+    sample.limits = points.limits;
+    std::size_t j = 0;
+    for (std::size_t s = 0; s < positions.size(); ++s) {
+        const std::size_t i = positions[s];
+        if (i == missing) {
+            continue;
+        }
+        sample.px[j] = points.px[i]; sample.py[j] = points.py[i]; sample.pz[j] = points.pz[i];
+        sample.vx[j] = points.vx[i]; sample.vy[j] = points.vy[i]; sample.vz[j] = points.vz[i];
+        sample.ax[j] = points.ax[i]; sample.ay[j] = points.ay[i]; sample.az[j] = points.az[i];
+        sample.friction[j] = points.friction[i];
+        sample.ids[j] = chosen[s];
+        ++j;
+    }
+}
+
+template void StratifiedSample::select(const ParticleStore&, ParticleStore&);
+template void StratifiedSample::select(const FloatParticleStore&, FloatParticleStore&);
@@ -0,0 +1,31 @@
+#pragma once
+#include "ParticleStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Deterministic stratified sample of k of the original numPoints points:
+// the original indices are split into k equal strata and one point of each
+// stratum is drawn from the seed. Every output time shows the same points,
+// for as long as they exist, so the sample can be followed over time.
+class StratifiedSample {
+public:
+    StratifiedSample(std::size_t numPoints, std::size_t k, std::uint64_t seed);
+
+    std::size_t size() const { return chosen.size(); }
+
+    // Copies the sampled points still in `points` to `sample` in the order
+    // of their original indices, which sample.ids holds. Instantiated for
+    // ParticleStore and FloatParticleStore.
+    template <typename Scalar>
+    void select(const BasicParticleStore<Scalar>& points, BasicParticleStore<Scalar>& sample);
+
+private:
+    std::size_t stratum(std::uint32_t id) const;
+
+    std::uint64_t total;
+    // Original index picked from each stratum.
+    std::vector<std::uint32_t> chosen;
+    // Position of each stratum's point in the store being sampled.
+    std::vector<std::size_t> positions;
+};
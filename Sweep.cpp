@@ -0,0 +1,113 @@
+#include "Sweep.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+
+namespace {
+
+double estimatedCost(const SimulationParams& params) {
+    const double steps = std::max(params.simulationTime, 0) / std::max(params.dt, 1e-12);
+    return static_cast<double>(std::max(params.numPoints, 0)) * steps;
+}
+
+std::string prefixed(const std::string& prefix, const std::string& filename) {
+    return filename.empty() ? filename : prefix + filename;
+}
+
+}
+
+void Sweep::assignOutputs(std::vector<SweepRun>& runs) {
+    for (SweepRun& run : runs) {
+        SimulationParams& params = run.params;
+        const std::string runPrefix = params.outputPrefix + run.name + "_";
+        if (!params.quiet) {
+            params.textOutputFile = runPrefix + "positions." + (params.outputFormat == "text" ? "txt" : params.outputFormat);
+        }
+        params.vtkOutputFile = prefixed(runPrefix, params.vtkOutputFile);
+        params.trajectoryFile = prefixed(runPrefix, params.trajectoryFile);
+        params.checkpointFile = prefixed(runPrefix, params.checkpointFile);
+    }
+}
+
+std::vector<SweepResult> Sweep::run(const std::vector<SweepRun>& runs, unsigned threads, const SinkFactory& addSinks) {
+    std::vector<SweepResult> results(runs.size());
+    std::vector<std::size_t> order(runs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return estimatedCost(runs[a].params) > estimatedCost(runs[b].params);
+    });
+
+    ThreadPool pool(threads);
+    pool.parallelFor(order.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            const SweepRun& run = runs[order[k]];
+            SweepResult& result = results[order[k]];
+            result.name = run.name;
+            result.label = run.label;
+
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                // Called from a pool worker, so the simulation's own
+                // parallel loops run inline on this thread.
+                Simulator simulator(run.params, &pool);
+                if (addSinks) {
+                    addSinks(simulator, run.params);
+                }
+                result.seed = simulator.seed();
+                result.points = simulator.pointCount();
+                std::ostringstream report;
+                simulator.simulate(report);
+                result.absorbed = simulator.absorbedCount();
+                result.pointSteps = static_cast<double>(result.points) * simulator.stepsPerOutput() *
+                                    std::max(simulator.outputCount() - 1, 0);
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    });
+    return results;
+}
+
+void Sweep::printSummary(const std::vector<SweepResult>& results, double wallSeconds, unsigned threads, std::ostream& out) {
+    std::size_t nameWidth = 3;
+    for (const SweepResult& result : results) {
+        nameWidth = std::max(nameWidth, result.name.size());
+    }
+
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3);
+    oss << std::left << std::setw(static_cast<int>(nameWidth)) << "run" << std::right << std::setw(10) << "points"
+        << std::setw(10) << "absorbed" << std::setw(10) << "seconds" << std::setw(14) << "Mpt-steps/s" << "  parameters\n";
+
+    double computeSeconds = 0.0;
+    std::size_t failed = 0;
+    for (const SweepResult& result : results) {
+        computeSeconds += result.seconds;
+        oss << std::left << std::setw(static_cast<int>(nameWidth)) << result.name << std::right;
+        if (!result.error.empty()) {
+            ++failed;
+            oss << "  failed: " << result.error << "\n";
+            continue;
+        }
+        const double rate = result.seconds > 0.0 ? result.pointSteps / result.seconds / 1e6 : 0.0;
+        oss << std::setw(10) << result.points << std::setw(10) << result.absorbed << std::setw(10) << result.seconds
+            << std::setw(14) << rate << "  " << result.label << "\n";
+    }
+
+    oss << "Sweep: " << results.size() << " runs";
+    if (failed > 0) {
+        oss << " (" << failed << " failed)";
+    }
+    oss << ", " << computeSeconds << " s of compute in " << wallSeconds << " s on " << threads << " thread(s)";
+    if (wallSeconds > 0.0) {
+        oss << ", " << std::setprecision(1) << computeSeconds / wallSeconds << "x";
+    }
+    oss << "\n";
+    out << oss.str();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Simulator.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// One simulation of a parameter sweep. name is unique within the sweep and
+// prefixes the run's output files; label lists the swept values.
+struct SweepRun {
+    std::string name;
+    std::string label;
+    SimulationParams params{};
+};
+
+struct SweepResult {
+    std::string name;
+    std::string label;
+    std::uint64_t seed = 0;
+    std::size_t points = 0;
+    std::size_t absorbed = 0;
+    // Point-steps integrated, for the throughput column.
+    double pointSteps = 0.0;
+    double seconds = 0.0;
+    // Empty unless the run failed.
+    std::string error;
+};
+
+// Runs many small simulations in one process. Each run is one task on a
+// shared pool, so runs execute concurrently on all threads while each
+// simulation's own parallel loops run inline on its worker; results do not
+// depend on the thread count. Longer runs (by points x steps) are started
+// first to keep the threads busy until the end.
+class Sweep {
+public:
+    // Called for every run before it starts, to add outputs such as VTK.
+    using SinkFactory = std::function<void(Simulator& simulator, const SimulationParams& params)>;
+
+    // Prefixes every output file of each run with `<outputPrefix><name>_`;
+    // text output goes to `<outputPrefix><name>_positions.<format>` unless
+    // quiet.
+    static void assignOutputs(std::vector<SweepRun>& runs);
+
+    // Results are in the order of `runs`; a failed run records its error
+    // and the others continue.
+    static std::vector<SweepResult> run(const std::vector<SweepRun>& runs, unsigned threads, const SinkFactory& addSinks = {});
+
+    static void printSummary(const std::vector<SweepResult>& results, double wallSeconds, unsigned threads, std::ostream& out);
+};
@@ -0,0 +1,217 @@
+#include "TextFrameSink.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Enough for "-" + 309 integer digits + "." + 3 decimals of any double.
+const std::size_t maxNumberChars = 320;
+
+class Appender {
+public:
+    Appender(std::string& out, std::size_t length) : out(out), length(length) {}
+
+    void reserve(std::size_t extra) {
+        if (length + extra > out.size()) {
+            out.resize(std::max(out.size() * 2, length + extra));
+        }
+    }
+
+    void literal(const char* text, std::size_t size) {
+        std::memcpy(&out[length], text, size);
+        length += size;
+    }
+
+    void character(char c) {
+        out[length++] = c;
+    }
+
+    template <typename Integer>
+    void integer(Integer value) {
+        length = std::to_chars(&out[length], &out[0] + out.size(), value).ptr - &out[0];
+    }
+
+    // Three-decimal fixed notation, identical to printf("%.3f"). Values are
+    // scaled to integer thousandths; the rare cases that land too close to a
+    // rounding tie to decide reliably go through std::to_chars.
+    void fixed(double value) {
+        const double magnitude = std::fabs(value);
+        if (magnitude < 1e9) {
+            const double scaled = magnitude * 1000.0;
+            const double whole = std::floor(scaled);
+            const double fraction = scaled - whole;
+            if (std::fabs(fraction - 0.5) > 1e-3) {
+                const auto thousandths = static_cast<std::uint64_t>(whole) + (fraction > 0.5 ? 1 : 0);
+                char* p = &out[length];
+                if (std::signbit(value)) {
+                    *p++ = '-';
+                }
+                p = std::to_chars(p, &out[0] + out.size(), thousandths / 1000).ptr;
+                const unsigned decimals = static_cast<unsigned>(thousandths % 1000);
+                p[0] = '.';
+                p[1] = static_cast<char>('0' + decimals / 100);
+                p[2] = static_cast<char>('0' + decimals / 10 % 10);
+                p[3] = static_cast<char>('0' + decimals % 10);
+                length = p + 4 - &out[0];
+                return;
+            }
+        }
+        length = std::to_chars(&out[length], &out[0] + out.size(), value, std::chars_format::fixed, 3).ptr - &out[0];
+    }
+
+    // Output times, e.g. "3" or "0.25".
+    void time(double value) {
+        length = std::to_chars(&out[length], &out[0] + out.size(), value, std::chars_format::general, 12).ptr - &out[0];
+    }
+
+    std::size_t size() const { return length; }
+
+private:
+    std::string& out;
+    std::size_t length;
+};
+
+void writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed to write text output: ") + std::strerror(errno));
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+}
+
+TextFrameSink::~TextFrameSink() {
+    if (ownsFd) {
+        ::close(fd);
+    }
+}
+
+std::unique_ptr<TextFrameSink> TextFrameSink::openFile(const std::string& filename, const TextOutputOptions& options) {
+    const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open output file " + filename + ": " + std::strerror(errno));
+    }
+    auto sink = std::make_unique<TextFrameSink>(fd, options);
+    sink->ownsFd = true;
+    return sink;
+}
+
+bool TextFrameSink::wants(int timeStep) const {
+    return timeStep % std::max(options.timeStride, 1) == 0;
+}
+
+std::size_t TextFrameSink::process(Frame& frame) {
+    if (frame.precision == Precision::Float) {
+        format(frame, frame.floatPoints);
+    } else {
+        format(frame, frame.points);
+    }
+    return 0;
+}
+
+template <typename Scalar>
+void TextFrameSink::format(Frame& frame, const BasicParticleStore<Scalar>& points) {
+    const int stride = std::max(options.pointStride, 1);
+    ProfileScope profile(ProfilePhase::TextFormat, frame.timeStep);
+
+    if (options.format == TextFormat::Text) {
+        Appender out(frame.text, 0);
+        out.reserve(64 + maxNumberChars);
+        out.literal("Time: ", 6);
+        out.time(frame.time);
+        out.literal(" seconds\n====================\n", 29);
+        frame.textLength = formatPoints(points, stride, frame.text, out.size());
+        Appender tail(frame.text, frame.textLength);
+        tail.reserve(1);
+        tail.character('\n');
+        frame.textLength = tail.size();
+        profile.add(frame.textLength, (points.size() + stride - 1) / stride);
+        return;
+    }
+
+    const char separator = options.format == TextFormat::CSV ? ',' : '\t';
+    Appender out(frame.text, 0);
+    for (std::size_t i = 0; i < points.size(); i += static_cast<std::size_t>(stride)) {
+        out.reserve(24 + 3 * (maxNumberChars + 1) + 24);
+        out.time(frame.time);
+        out.character(separator);
+        out.integer(points.id(i));
+        out.character(separator);
+        out.fixed(points.px[i]);
+        out.character(separator);
+        out.fixed(points.py[i]);
+        out.character(separator);
+        out.fixed(points.pz[i]);
+        out.character('\n');
+    }
+    frame.textLength = out.size();
+    profile.add(frame.textLength, (points.size() + stride - 1) / stride);
+}
+
+std::size_t TextFrameSink::commit(Frame& frame) {
+    ProfileScope profile(ProfilePhase::TextWrite, frame.timeStep);
+    // Keep anything already queued on std::cout ahead of this frame.
+    std::cout.flush();
+
+    std::size_t bytes = 0;
+    if (!headerWritten && options.format != TextFormat::Text) {
+        const char* header = options.format == TextFormat::CSV ? "time,point,x,y,z\n" : "time\tpoint\tx\ty\tz\n";
+        writeAll(fd, header, std::strlen(header));
+        bytes += std::strlen(header);
+    }
+    headerWritten = true;
+
+    writeAll(fd, frame.text.data(), frame.textLength);
+    profile.add(bytes + frame.textLength, 0);
+    return bytes + frame.textLength;
+}
+
+bool TextFrameSink::parseFormat(const std::string& name, TextFormat& format) {
+    if (name == "text") {
+        format = TextFormat::Text;
+    } else if (name == "csv") {
+        format = TextFormat::CSV;
+    } else if (name == "tsv") {
+        format = TextFormat::TSV;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+template <typename Scalar>
+std::size_t TextFrameSink::formatPoints(const BasicParticleStore<Scalar>& points, int stride, std::string& text, std::size_t length) {
+    Appender out(text, length);
+    for (std::size_t i = 0; i < points.size(); i += static_cast<std::size_t>(std::max(stride, 1))) {
+        out.reserve(32 + 3 * (maxNumberChars + 2));
+        out.literal("Point ", 6);
+        out.integer(points.id(i));
+        out.literal(": (", 3);
+        out.fixed(points.px[i]);
+        out.literal(", ", 2);
+        out.fixed(points.py[i]);
+        out.literal(", ", 2);
+        out.fixed(points.pz[i]);
+        out.literal(")\n", 2);
+    }
+    return out.size();
+}
+
+template std::size_t TextFrameSink::formatPoints(const ParticleStore&, int, std::string&, std::size_t);
+template std::size_t TextFrameSink::formatPoints(const FloatParticleStore&, int, std::string&, std::size_t);
@@ -0,0 +1,49 @@
+#pragma once
+#include "OutputPipeline.h"
+#include <memory>
+#include <string>
+
+enum class TextFormat { Text, CSV, TSV };
+
+struct TextOutputOptions {
+    TextFormat format = TextFormat::Text;
+    int pointStride = 1;
+    int timeStride = 1;
+};
+
+// Prints point positions for every output time. Text is formatted with
+// std::to_chars into the frame's reusable buffer on a writer thread and
+// handed to the file descriptor in one write() per frame, in frame order.
+//
+//   text: "Time: t seconds" header followed by "Point i: (x, y, z)" lines
+//   csv:  "time,point,x,y,z" header row, then one row per point
+//   tsv:  as csv, tab separated
+class TextFrameSink : public FrameSink {
+public:
+    TextFrameSink(int fd, const TextOutputOptions& options) : fd(fd), options(options) {}
+    ~TextFrameSink() override;
+
+    // Writes to a new file instead of a caller's descriptor; throws if it
+    // cannot be created.
+    static std::unique_ptr<TextFrameSink> openFile(const std::string& filename, const TextOutputOptions& options);
+
+    const char* name() const override { return "text"; }
+    bool wants(int timeStep) const override;
+    std::size_t process(Frame& frame) override;
+    std::size_t commit(Frame& frame) override;
+
+    static bool parseFormat(const std::string& name, TextFormat& format);
+    // Appends the positions of every stride-th point to out[length...],
+    // growing out as needed, and returns the new length.
+    template <typename Scalar>
+    static std::size_t formatPoints(const BasicParticleStore<Scalar>& points, int stride, std::string& out, std::size_t length);
+
+private:
+    template <typename Scalar>
+    void format(Frame& frame, const BasicParticleStore<Scalar>& points);
+
+    int fd;
+    bool ownsFd = false;
+    TextOutputOptions options;
+    bool headerWritten = false;
+};
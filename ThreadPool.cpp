@@ -0,0 +1,130 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+thread_local bool insidePool = false;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+    : participants(threads == 0 ? hardwareThreads() : threads), queues(new ChunkQueue[participants]) {
+    workers.reserve(participants - 1);
+    for (unsigned i = 1; i < participants; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain, const RangeFunction& body) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = (count + grain - 1) / grain;
+
+    // Nested calls and single-chunk ranges run inline on the caller.
+    if (participants == 1 || chunks == 1 || insidePool) {
+        body(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> dispatch(dispatchMutex);
+    for (unsigned p = 0; p < participants; ++p) {
+        queues[p].next.store(chunks * p / participants, std::memory_order_relaxed);
+        queues[p].end = chunks * (p + 1) / participants;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->body = &body;
+        this->count = count;
+        this->grain = grain;
+        error = nullptr;
+        pending = participants - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    insidePool = true;
+    runChunks(0);
+    insidePool = false;
+
+    std::exception_ptr failure;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending == 0; });
+        this->body = nullptr;
+        failure = error;
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    insidePool = true;
+    std::uint64_t seen = 0;
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        lock.unlock();
+
+        runChunks(index);
+
+        lock.lock();
+        if (--pending == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runChunks(unsigned self) {
+    // Drain our own queue first, then steal from the others in ring order.
+    for (unsigned offset = 0; offset < participants; ++offset) {
+        ChunkQueue& queue = queues[(self + offset) % participants];
+        std::size_t chunk;
+        while (claimChunk(queue, chunk)) {
+            const std::size_t begin = chunk * grain;
+            const std::size_t end = std::min(count, begin + grain);
+            try {
+                (*body)(begin, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+}
+
+bool ThreadPool::claimChunk(ChunkQueue& queue, std::size_t& chunk) {
+    if (queue.next.load(std::memory_order_relaxed) >= queue.end) {
+        return false;
+    }
+    chunk = queue.next.fetch_add(1, std::memory_order_relaxed);
+    return chunk < queue.end;
+}
+
+unsigned ThreadPool::hardwareThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::size_t ThreadPool::cacheGrain(std::size_t bytesPerItem, std::size_t cacheBytes) {
+    const std::size_t items = cacheBytes / std::max<std::size_t>(bytesPerItem, 1);
+    return std::max<std::size_t>(64, items & ~static_cast<std::size_t>(63));
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool. parallelFor splits [0, count) into chunks of
+// `grain` items; every participant (the workers plus the calling thread)
+// starts on its own contiguous run of chunks and steals from the others once
+// it runs dry. Workers sleep between calls and are only joined on destruction.
+class ThreadPool {
+public:
+    using RangeFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+    // threads counts the calling thread; 0 means one per hardware thread.
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return participants; }
+
+    void parallelFor(std::size_t count, std::size_t grain, const RangeFunction& body);
+
+    static unsigned hardwareThreads();
+    // Largest multiple of 64 items whose working set fits in `cacheBytes`.
+    static std::size_t cacheGrain(std::size_t bytesPerItem, std::size_t cacheBytes = 256 * 1024);
+
+private:
+    struct alignas(64) ChunkQueue {
+        std::atomic<std::size_t> next{0};
+        std::size_t end = 0;
+    };
+
+    void workerLoop(unsigned index);
+    void runChunks(unsigned self);
+    bool claimChunk(ChunkQueue& queue, std::size_t& chunk);
+
+    unsigned participants;
+    std::vector<std::thread> workers;
+    std::unique_ptr<ChunkQueue[]> queues;
+
+    std::mutex dispatchMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::uint64_t generation = 0;
+    unsigned pending = 0;
+    bool stopping = false;
+
+    const RangeFunction* body = nullptr;
+    std::size_t count = 0;
+    std::size_t grain = 1;
+    std::exception_ptr error;
+};
@@ -0,0 +1,341 @@
+#include "Trajectory.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char trajectoryMagic[8] = {'P', 'S', 'I', 'M', 'T', 'R', 'J', '\0'};
+const std::uint32_t trajectoryVersion = 1;
+const std::size_t frameHeaderBytes = sizeof(std::int64_t) + sizeof(double);
+const std::size_t componentCount = 6;
+// With TrajectoryAccelerations, ax/ay/az follow the six state components.
+const std::size_t maxComponentCount = 9;
+
+std::size_t frameComponents(std::uint32_t flags) {
+    return (flags & TrajectoryAccelerations) ? maxComponentCount : componentCount;
+}
+
+template <typename Scalar>
+const Scalar* sourceComponent(const BasicParticleStore<Scalar>& points, std::size_t c) {
+    const AlignedVector<Scalar>* components[maxComponentCount] = {
+        &points.px, &points.py, &points.pz, &points.vx, &points.vy, &points.vz, &points.ax, &points.ay, &points.az
+    };
+    return components[c]->data();
+}
+
+double* targetComponent(ParticleStore& points, std::size_t c) {
+    AlignedVector<double>* components[maxComponentCount] = {
+        &points.px, &points.py, &points.pz, &points.vx, &points.vy, &points.vz, &points.ax, &points.ay, &points.az
+    };
+    return components[c]->data();
+}
+
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& filename, const SimulationParams& params, std::uint64_t seed,
+                                   const TrajectoryOptions& options)
+    : filename(filename), file(std::fopen(filename.c_str(), "wb")) {
+    if (!file) {
+        throw std::runtime_error("Could not open trajectory file: " + filename);
+    }
+
+    const std::uint64_t n = static_cast<std::uint64_t>(params.numPoints);
+    const std::size_t elementBytes = options.float32 ? sizeof(float) : sizeof(double);
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, trajectoryMagic, sizeof(trajectoryMagic));
+    header.version = trajectoryVersion;
+    header.flags = (options.float32 ? TrajectoryFloat32 : 0u) | (options.delta ? TrajectoryDelta : 0u) |
+                   (options.accelerations ? TrajectoryAccelerations : 0u);
+    header.seed = seed;
+    header.numPoints = n;
+    header.frameCount = 0;
+    header.frameStride = frameHeaderBytes + frameComponents(header.flags) * n * elementBytes;
+    header.dataOffset = sizeof(TrajectoryHeader) + 4 * n * sizeof(double);
+    header.keyframeInterval = options.keyframeInterval > 0 ? options.keyframeInterval : 1;
+    header.numForces = params.numForces;
+    header.simulationTime = params.simulationTime;
+    header.cubeSize = params.cubeSize;
+    header.minFriction = params.minFriction;
+    header.maxFriction = params.maxFriction;
+    header.minAcceleration = params.minAcceleration;
+    header.maxAcceleration = params.maxAcceleration;
+    header.minVelocity = params.minVelocity;
+    header.maxVelocity = params.maxVelocity;
+    header.minInitialVelocity = params.minInitialVelocity;
+    header.maxInitialVelocity = params.maxInitialVelocity;
+
+    std::fwrite(&header, sizeof(header), 1, file);
+    block.resize(header.frameStride);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+std::size_t TrajectoryWriter::process(Frame&) {
+    return 0;
+}
+
+// Delta frames depend on the previous frame, so encoding happens in commit().
+std::size_t TrajectoryWriter::commit(Frame& frame) {
+    if (frame.precision == Precision::Float) {
+        return write(frame, frame.floatPoints);
+    }
+    return write(frame, frame.points);
+}
+
+template <typename Scalar>
+std::size_t TrajectoryWriter::write(const Frame& frame, const BasicParticleStore<Scalar>& framePoints) {
+    const std::size_t n = static_cast<std::size_t>(header.numPoints);
+    ProfileScope profile(ProfilePhase::Trajectory, frame.timeStep);
+    if (!framePoints.indexed && framePoints.size() != n) {
+        throw std::runtime_error("Trajectory frame has an unexpected number of points: " + filename);
+    }
+    const BasicParticleStore<Scalar>& points = framePoints.indexed ? expand(framePoints) : framePoints;
+
+    std::size_t bytes = 0;
+    if (header.frameCount == 0) {
+        // The static block is double in every file, whatever the precision.
+        const AlignedVector<Scalar>* staticBlock[4] = {
+            &points.friction, &points.ax, &points.ay, &points.az
+        };
+        std::vector<double> widened;
+        for (const auto* component : staticBlock) {
+            const double* values = nullptr;
+            if constexpr (std::is_same<Scalar, double>::value) {
+                values = component->data();
+            } else {
+                widened.assign(component->begin(), component->end());
+                values = widened.data();
+            }
+            std::fwrite(values, sizeof(double), n, file);
+            bytes += n * sizeof(double);
+        }
+        previous.assign(frameComponents(header.flags) * n, 0.0);
+    }
+
+    const bool keyframe = !(header.flags & TrajectoryDelta) || header.frameCount % header.keyframeInterval == 0;
+    if (header.flags & TrajectoryFloat32) {
+        encode<float>(frame, points, keyframe);
+    } else {
+        encode<double>(frame, points, keyframe);
+    }
+
+    if (std::fwrite(block.data(), 1, block.size(), file) != block.size()) {
+        throw std::runtime_error("Failed to write trajectory file: " + filename);
+    }
+    bytes += block.size();
+
+    // Keep the on-disk frame count current so an interrupted run stays readable.
+    ++header.frameCount;
+    std::fseek(file, static_cast<long>(offsetof(TrajectoryHeader, frameCount)), SEEK_SET);
+    std::fwrite(&header.frameCount, sizeof(header.frameCount), 1, file);
+    std::fseek(file, 0, SEEK_END);
+    std::fflush(file);
+
+    profile.add(bytes, n);
+    return bytes;
+}
+
+// Frames keep a fixed stride and the original point order: points are written
+// back at their original index, and points removed by an absorbing wall as NaN.
+template <typename Scalar>
+const BasicParticleStore<Scalar>& TrajectoryWriter::expand(const BasicParticleStore<Scalar>& points) {
+    const std::size_t n = static_cast<std::size_t>(header.numPoints);
+    if (points.size() > n || points.ids.size() != points.size()) {
+        throw std::runtime_error("Trajectory frame has an unexpected number of points: " + filename);
+    }
+
+    BasicParticleStore<Scalar>* out = nullptr;
+    if constexpr (std::is_same<Scalar, double>::value) {
+        out = &expanded;
+    } else {
+        out = &floatExpanded;
+    }
+    const Scalar absorbed = std::numeric_limits<Scalar>::quiet_NaN();
+    out->resize(n);
+    AlignedVector<Scalar>* targets[10] = {
+        &out->px, &out->py, &out->pz, &out->vx, &out->vy, &out->vz,
+        &out->ax, &out->ay, &out->az, &out->friction
+    };
+    const AlignedVector<Scalar>* sources[10] = {
+        &points.px, &points.py, &points.pz, &points.vx, &points.vy, &points.vz,
+        &points.ax, &points.ay, &points.az, &points.friction
+    };
+    for (std::size_t c = 0; c < 10; ++c) {
+        std::fill(targets[c]->begin(), targets[c]->end(), absorbed);
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            (*targets[c])[points.ids[i]] = (*sources[c])[i];
+        }
+    }
+    return *out;
+}
+
+template <typename T, typename Scalar>
+void TrajectoryWriter::encode(const Frame& frame, const BasicParticleStore<Scalar>& points, bool keyframe) {
+    const std::size_t n = static_cast<std::size_t>(header.numPoints);
+    const std::int64_t timeStep = frame.timeStep;
+    const double time = frame.time;
+
+    char* out = block.data();
+    std::memcpy(out, &timeStep, sizeof(timeStep));
+    std::memcpy(out + sizeof(timeStep), &time, sizeof(time));
+    T* values = reinterpret_cast<T*>(out + frameHeaderBytes);
+
+    // The writer tracks the decoded values, exactly as the reader computes
+    // them, so quantization error does not accumulate across delta frames.
+    for (std::size_t c = 0; c < frameComponents(header.flags); ++c) {
+        const Scalar* source = sourceComponent(points, c);
+        double* decoded = previous.data() + c * n;
+        T* encoded = values + c * n;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (keyframe) {
+                encoded[i] = static_cast<T>(source[i]);
+                decoded[i] = static_cast<double>(encoded[i]);
+            } else {
+                encoded[i] = static_cast<T>(source[i] - decoded[i]);
+                decoded[i] = decoded[i] + static_cast<double>(encoded[i]);
+            }
+        }
+    }
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open trajectory file: " + filename);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(TrajectoryHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a trajectory file: " + filename);
+    }
+    size = static_cast<std::size_t>(info.st_size);
+
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map trajectory file: " + filename);
+    }
+    data = static_cast<const char*>(mapping);
+    fileHeader = reinterpret_cast<const TrajectoryHeader*>(data);
+
+    // The layout follows from numPoints and the flags; anything else is a
+    // corrupt header, and the static block must be in the file.
+    const TrajectoryHeader& h = *fileHeader;
+    const std::uint64_t n = h.numPoints;
+    const std::uint64_t elementBytes = (h.flags & TrajectoryFloat32) ? sizeof(float) : sizeof(double);
+    const bool pointsFit = n <= size / (4 * sizeof(double));
+    if (std::memcmp(h.magic, trajectoryMagic, sizeof(trajectoryMagic)) != 0 || h.version != trajectoryVersion ||
+        (h.flags & ~static_cast<std::uint32_t>(TrajectoryFloat32 | TrajectoryDelta | TrajectoryAccelerations)) != 0 ||
+        !pointsFit ||
+        h.dataOffset != sizeof(TrajectoryHeader) + 4 * n * sizeof(double) || h.dataOffset > size ||
+        h.frameStride != frameHeaderBytes + frameComponents(h.flags) * n * elementBytes || h.keyframeInterval == 0) {
+        ::munmap(mapping, size);
+        throw std::runtime_error("Not a trajectory file or corrupt header: " + filename);
+    }
+
+    // Trust the file size as well as the header so a truncated last frame
+    // is never exposed.
+    const std::size_t available = (size - h.dataOffset) / h.frameStride;
+    frames = static_cast<std::size_t>(std::min<std::uint64_t>(fileHeader->frameCount, available));
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    if (data) {
+        ::munmap(const_cast<char*>(data), size);
+    }
+}
+
+SimulationParams TrajectoryReader::params() const {
+    SimulationParams params;
+    params.cubeSize = fileHeader->cubeSize;
+    params.numPoints = static_cast<int>(fileHeader->numPoints);
+    params.minFriction = fileHeader->minFriction;
+    params.maxFriction = fileHeader->maxFriction;
+    params.numForces = fileHeader->numForces;
+    params.minAcceleration = fileHeader->minAcceleration;
+    params.maxAcceleration = fileHeader->maxAcceleration;
+    params.minVelocity = fileHeader->minVelocity;
+    params.maxVelocity = fileHeader->maxVelocity;
+    params.minInitialVelocity = fileHeader->minInitialVelocity;
+    params.maxInitialVelocity = fileHeader->maxInitialVelocity;
+    params.simulationTime = fileHeader->simulationTime;
+    params.enableVTKOutput = false;
+    return params;
+}
+
+const char* TrajectoryReader::frameBlock(std::size_t index) const {
+    if (index >= frames) {
+        throw std::out_of_range("Trajectory frame index out of range");
+    }
+    return data + fileHeader->dataOffset + index * fileHeader->frameStride;
+}
+
+int TrajectoryReader::timeStep(std::size_t index) const {
+    std::int64_t timeStep;
+    std::memcpy(&timeStep, frameBlock(index), sizeof(timeStep));
+    return static_cast<int>(timeStep);
+}
+
+double TrajectoryReader::time(std::size_t index) const {
+    double time;
+    std::memcpy(&time, frameBlock(index) + sizeof(std::int64_t), sizeof(time));
+    return time;
+}
+
+void TrajectoryReader::readFrame(std::size_t index, ParticleStore& points) const {
+    const std::size_t n = numPoints();
+    points.clear();
+    points.resize(n);
+    points.limits = {fileHeader->minVelocity, fileHeader->maxVelocity,
+                     fileHeader->minAcceleration, fileHeader->maxAcceleration};
+
+    const double* staticBlock = reinterpret_cast<const double*>(data + sizeof(TrajectoryHeader));
+    std::memcpy(points.friction.data(), staticBlock, n * sizeof(double));
+    std::memcpy(points.ax.data(), staticBlock + n, n * sizeof(double));
+    std::memcpy(points.ay.data(), staticBlock + 2 * n, n * sizeof(double));
+    std::memcpy(points.az.data(), staticBlock + 3 * n, n * sizeof(double));
+
+    if (fileHeader->flags & TrajectoryFloat32) {
+        decode<float>(index, points);
+    } else {
+        decode<double>(index, points);
+    }
+}
+
+template <typename T>
+void TrajectoryReader::decode(std::size_t index, ParticleStore& points) const {
+    const std::size_t n = numPoints();
+    const bool delta = (fileHeader->flags & TrajectoryDelta) != 0;
+    const std::size_t keyframe = delta ? index - index % fileHeader->keyframeInterval : index;
+
+    for (std::size_t c = 0; c < frameComponents(fileHeader->flags); ++c) {
+        double* target = targetComponent(points, c);
+        for (std::size_t f = keyframe; f <= index; ++f) {
+            const T* values = reinterpret_cast<const T*>(frameBlock(f) + frameHeaderBytes) + c * n;
+            if (f == keyframe) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    target[i] = static_cast<double>(values[i]);
+                }
+            } else {
+                for (std::size_t i = 0; i < n; ++i) {
+                    target[i] = target[i] + static_cast<double>(values[i]);
+                }
+            }
+        }
+    }
+}
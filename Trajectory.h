@@ -0,0 +1,117 @@
+#pragma once
+#include "OutputPipeline.h"
+#include "Simulator.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Native trajectory file layout (host byte order):
+//
+//   TrajectoryHeader
+//   static block: friction[N], ax[N], ay[N], az[N] as double
+//   frame blocks, each frameStride bytes:
+//       int64 timeStep, double time,
+//       px[N] py[N] pz[N] vx[N] vy[N] vz[N] as float or double
+//       ax[N] ay[N] az[N] as well with TrajectoryAccelerations
+//
+// With TrajectoryDelta set, every frame that is not a keyframe stores the
+// difference from the previous frame's decoded values. Any frame is found at
+// dataOffset + index * frameStride without scanning the file. Points removed
+// by an absorbing wall are stored as NaN from then on. Runs with per-step
+// forces set TrajectoryAccelerations, since their accelerations change
+// between frames; the static block then holds the first frame's values.
+enum TrajectoryFlags : std::uint32_t {
+    TrajectoryFloat32 = 1u << 0,
+    TrajectoryDelta = 1u << 1,
+    TrajectoryAccelerations = 1u << 2
+};
+
+struct TrajectoryHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint64_t seed;
+    std::uint64_t numPoints;
+    std::uint64_t frameCount;
+    std::uint64_t frameStride;
+    std::uint64_t dataOffset;
+    std::uint32_t keyframeInterval;
+    std::int32_t numForces;
+    std::int32_t simulationTime;
+    std::int32_t reserved;
+    double cubeSize;
+    double minFriction;
+    double maxFriction;
+    double minAcceleration;
+    double maxAcceleration;
+    double minVelocity;
+    double maxVelocity;
+    double minInitialVelocity;
+    double maxInitialVelocity;
+};
+
+struct TrajectoryOptions {
+    bool float32 = false;
+    bool delta = false;
+    bool accelerations = false;
+    std::uint32_t keyframeInterval = 32;
+};
+
+class TrajectoryWriter : public FrameSink {
+public:
+    TrajectoryWriter(const std::string& filename, const SimulationParams& params, std::uint64_t seed,
+                     const TrajectoryOptions& options);
+    ~TrajectoryWriter() override;
+
+    const char* name() const override { return "trajectory"; }
+    std::size_t process(Frame& frame) override;
+    std::size_t commit(Frame& frame) override;
+
+private:
+    template <typename Scalar>
+    std::size_t write(const Frame& frame, const BasicParticleStore<Scalar>& points);
+    template <typename Scalar>
+    const BasicParticleStore<Scalar>& expand(const BasicParticleStore<Scalar>& points);
+    template <typename T, typename Scalar>
+    void encode(const Frame& frame, const BasicParticleStore<Scalar>& points, bool keyframe);
+
+    std::string filename;
+    std::FILE* file = nullptr;
+    TrajectoryHeader header;
+    std::vector<char> block;
+    std::vector<double> previous;
+    ParticleStore expanded;
+    FloatParticleStore floatExpanded;
+};
+
+// Read-only, memory-mapped view of a trajectory file.
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const std::string& filename);
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    const TrajectoryHeader& header() const { return *fileHeader; }
+    SimulationParams params() const;
+    std::size_t frameCount() const { return frames; }
+    std::size_t numPoints() const { return static_cast<std::size_t>(fileHeader->numPoints); }
+    // Whether every frame stores its own accelerations.
+    bool hasFrameAccelerations() const { return (fileHeader->flags & TrajectoryAccelerations) != 0; }
+
+    int timeStep(std::size_t index) const;
+    double time(std::size_t index) const;
+    void readFrame(std::size_t index, ParticleStore& points) const;
+
+private:
+    const char* frameBlock(std::size_t index) const;
+    template <typename T>
+    void decode(std::size_t index, ParticleStore& points) const;
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+    const TrajectoryHeader* fileHeader = nullptr;
+    std::size_t frames = 0;
+};
@@ -0,0 +1,36 @@
+#include "VTKOptions.h"
+#include "Simulator.h"
+#include "ThreadPool.h"
+
+VTKOutputOptions VTKOutputOptions::fromParams(const SimulationParams& params) {
+    VTKOutputOptions options;
+    options.pieces = params.vtkPieces > 0 ? params.vtkPieces : static_cast<int>(ThreadPool::hardwareThreads());
+    parseEncoding(params.vtkEncoding, options.encoding);
+    parseCompression(params.vtkCompression, options.compression);
+    options.compressionLevel = params.vtkCompressionLevel;
+    return options;
+}
+
+bool VTKOutputOptions::parseEncoding(const std::string& name, VTKEncoding& encoding) {
+    if (name == "appended") {
+        encoding = VTKEncoding::Appended;
+    } else if (name == "base64") {
+        encoding = VTKEncoding::Base64;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool VTKOutputOptions::parseCompression(const std::string& name, VTKCompression& compression) {
+    if (name == "none") {
+        compression = VTKCompression::None;
+    } else if (name == "lz4") {
+        compression = VTKCompression::LZ4;
+    } else if (name == "zlib") {
+        compression = VTKCompression::ZLib;
+    } else {
+        return false;
+    }
+    return true;
+}
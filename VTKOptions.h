@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+
+struct SimulationParams;
+
+// Appended stores the arrays as raw bytes after the XML; Base64 encodes
+// them as text, which is about a third larger but plain ASCII.
+enum class VTKEncoding { Appended, Base64 };
+enum class VTKCompression { None, LZ4, ZLib };
+
+// How .vtp frames are written. Kept free of VTK headers so the core can
+// parse and validate the settings in builds without VTK.
+struct VTKOutputOptions {
+    // Frames with more than one piece are split into that many .vtp files,
+    // written concurrently and tied together by a .pvtp file.
+    int pieces = 1;
+    VTKEncoding encoding = VTKEncoding::Base64;
+    VTKCompression compression = VTKCompression::ZLib;
+    // 1 (fastest) to 9 (smallest).
+    int compressionLevel = 5;
+
+    // vtk_pieces = 0 means one piece per hardware thread.
+    static VTKOutputOptions fromParams(const SimulationParams& params);
+    static bool parseEncoding(const std::string& name, VTKEncoding& encoding);
+    static bool parseCompression(const std::string& name, VTKCompression& compression);
+};
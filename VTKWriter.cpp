@@ -1,91 +1,362 @@
 #include "VTKWriter.h"
+#include "Trajectory.h"
+#include "Profiler.h"
 #include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkCellArray.h>
-#include <vtkVertex.h>
 #include <vtkXMLPolyDataWriter.h>
+#include <vtkXMLImageDataWriter.h>
+#include <vtkImageData.h>
+#include <vtkCellData.h>
 #include <vtkNew.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkSOADataArrayTemplate.h>
+#include <vtkTypeUInt32Array.h>
 #include <vtkPointData.h>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <numeric>
 #include <sstream>
-#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
 
-void VTKWriter::writePoints(const std::vector<Point>& points, const std::string& filename, int timeStep) {
-    vtkNew<vtkPoints> vtkPoints;
-    vtkNew<vtkCellArray> vertices;
-    vtkNew<vtkDoubleArray> velocityArray;
-    vtkNew<vtkDoubleArray> accelerationArray;
-    vtkNew<vtkDoubleArray> frictionArray;
+namespace {
 
-    velocityArray->SetName("Velocity");
-    velocityArray->SetNumberOfComponents(3);
+// Wraps count values at data without copying; VTK never frees or writes them.
+template <typename Array, typename Value>
+void wrap(Array* array, const Value* data, std::size_t count) {
+    array->SetArray(const_cast<Value*>(data), static_cast<vtkIdType>(count), 1);
+}
 
-    accelerationArray->SetName("Acceleration");
-    accelerationArray->SetNumberOfComponents(3);
+// Wraps points [begin, end) of the three components.
+template <typename Scalar>
+void wrapVector(vtkSOADataArrayTemplate<Scalar>* array, const char* name, const AlignedVector<Scalar>& x,
+                const AlignedVector<Scalar>& y, const AlignedVector<Scalar>& z, std::size_t begin, std::size_t end) {
+    array->SetName(name);
+    array->SetNumberOfComponents(3);
+    const AlignedVector<Scalar>* components[3] = {&x, &y, &z};
+    for (int c = 0; c < 3; ++c) {
+        array->SetArray(c, const_cast<Scalar*>(components[c]->data() + begin), static_cast<vtkIdType>(end - begin), true, true);
+    }
+}
 
-    frictionArray->SetName("Friction");
-    frictionArray->SetNumberOfComponents(1);
+void configure(vtkXMLWriter* writer, const VTKOutputOptions& options) {
+    writer->SetDataModeToAppended();
+    writer->SetEncodeAppendedData(options.encoding == VTKEncoding::Base64);
+    switch (options.compression) {
+    case VTKCompression::None:
+        writer->SetCompressorTypeToNone();
+        break;
+    case VTKCompression::LZ4:
+        writer->SetCompressorTypeToLZ4();
+        break;
+    case VTKCompression::ZLib:
+        writer->SetCompressorTypeToZLib();
+        break;
+    }
+    if (options.compression != VTKCompression::None) {
+        writer->SetCompressionLevel(options.compressionLevel);
+    }
+}
+
+std::string pieceFilename(const std::string& baseFilename, int timeStep, std::size_t piece) {
+    std::ostringstream oss;
+    oss << baseFilename << "_t" << std::setfill('0') << std::setw(4) << timeStep << "_p" << piece << ".vtp";
+    return oss.str();
+}
+
+std::size_t fileSize(const std::string& path) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : static_cast<std::size_t>(size);
+}
+
+// The .pvtp only declares the arrays and names the pieces; sources are
+// relative to its own directory.
+void writeSummary(const std::string& path, const std::vector<std::string>& pieces, const char* type, bool hasIds) {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open VTK file: " + path);
+    }
+    file << "<?xml version=\"1.0\"?>\n";
+    file << "<VTKFile type=\"PPolyData\" version=\"0.1\">\n";
+    file << "  <PPolyData GhostLevel=\"0\">\n";
+    file << "    <PPointData Vectors=\"Velocity\">\n";
+    file << "      <PDataArray type=\"" << type << "\" Name=\"Velocity\" NumberOfComponents=\"3\"/>\n";
+    file << "      <PDataArray type=\"" << type << "\" Name=\"Acceleration\" NumberOfComponents=\"3\"/>\n";
+    file << "      <PDataArray type=\"" << type << "\" Name=\"Friction\"/>\n";
+    if (hasIds) {
+        file << "      <PDataArray type=\"UInt32\" Name=\"Id\"/>\n";
+    }
+    file << "    </PPointData>\n";
+    file << "    <PPoints>\n";
+    file << "      <PDataArray type=\"" << type << "\" Name=\"Position\" NumberOfComponents=\"3\"/>\n";
+    file << "    </PPoints>\n";
+    for (const std::string& piece : pieces) {
+        file << "    <Piece Source=\"" << std::filesystem::path(piece).filename().string() << "\"/>\n";
+    }
+    file << "  </PPolyData>\n";
+    file << "</VTKFile>\n";
+    if (!file) {
+        throw std::runtime_error("Failed to write VTK file: " + path);
+    }
+}
 
-    for (size_t i = 0; i < points.size(); ++i) {
-        const Point& point = points[i];
+}
 
-        vtkPoints->InsertNextPoint(point.position.x, point.position.y, point.position.z);
+VTKFrameWriter::VTKFrameWriter(const VTKOutputOptions& options) : options(options) {
+    this->options.pieces = std::max(this->options.pieces, 1);
+    if (this->options.pieces > 1) {
+        const unsigned threads = std::min<unsigned>(static_cast<unsigned>(this->options.pieces), ThreadPool::hardwareThreads());
+        pool = std::make_unique<ThreadPool>(threads);
+    }
+}
 
-        vtkNew<vtkVertex> vertex;
-        vertex->GetPointIds()->SetId(0, i);
-        vertices->InsertNextCell(vertex);
+std::shared_ptr<const std::vector<vtkIdType>> VTKFrameWriter::vertexIds(std::size_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ids || ids->size() < count + 1) {
+        // Frames in flight keep the old buffer alive through their copy.
+        auto grown = std::make_shared<std::vector<vtkIdType>>(count + 1);
+        std::iota(grown->begin(), grown->end(), vtkIdType(0));
+        ids = std::move(grown);
+    }
+    return ids;
+}
 
-        double velocity[3] = {point.velocity.x, point.velocity.y, point.velocity.z};
-        velocityArray->InsertNextTuple(velocity);
+std::string VTKFrameWriter::frameFilename(const std::string& baseFilename, int timeStep) const {
+    const std::string path = VTKWriter::frameFilename(baseFilename, timeStep);
+    return options.pieces > 1 ? path.substr(0, path.size() - 4) + ".pvtp" : path;
+}
 
-        double acceleration[3] = {point.acceleration.x, point.acceleration.y, point.acceleration.z};
-        accelerationArray->InsertNextTuple(acceleration);
+template <typename Scalar>
+std::size_t VTKFrameWriter::write(const BasicParticleStore<Scalar>& points, const std::string& filename, int timeStep) {
+    const std::size_t n = points.size();
+    if (!pool) {
+        return writePiece(points, 0, n, frameFilename(filename, timeStep), timeStep);
+    }
 
-        frictionArray->InsertNextValue(point.frictionCoefficient);
+    // Every piece gets at least one point unless the frame is empty.
+    const std::size_t pieces = std::max<std::size_t>(std::min<std::size_t>(options.pieces, n), 1);
+    std::vector<std::string> paths(pieces);
+    std::vector<std::size_t> bytes(pieces, 0);
+    for (std::size_t k = 0; k < pieces; ++k) {
+        paths[k] = pieceFilename(filename, timeStep, k);
     }
+    pool->parallelFor(pieces, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t k = first; k < last; ++k) {
+            bytes[k] = writePiece(points, n * k / pieces, n * (k + 1) / pieces, paths[k], timeStep);
+        }
+    });
+
+    ProfileScope write(ProfilePhase::VTKWrite, timeStep);
+    const std::string path = frameFilename(filename, timeStep);
+    writeSummary(path, paths, std::is_same<Scalar, float>::value ? "Float32" : "Float64", points.indexed);
+    const std::size_t summaryBytes = fileSize(path);
+    write.add(summaryBytes, 0);
+    return std::accumulate(bytes.begin(), bytes.end(), summaryBytes);
+}
+
+template <typename Scalar>
+std::size_t VTKFrameWriter::writePiece(const BasicParticleStore<Scalar>& points, std::size_t begin, std::size_t end,
+                                       const std::string& path, int timeStep) {
+    // Point data is written as Float32 for float stores, Float64 otherwise.
+    using DataArray = typename std::conditional<std::is_same<Scalar, float>::value, vtkFloatArray, vtkDoubleArray>::type;
+
+    ProfileScope build(ProfilePhase::VTKBuild, timeStep);
+    const std::size_t n = end - begin;
+    const std::shared_ptr<const std::vector<vtkIdType>> vertices = vertexIds(n);
+
+    // Point k is vertex cell k: offsets 0 ... n, connectivity 0 ... n - 1.
+    vtkNew<vtkIdTypeArray> offsets;
+    vtkNew<vtkIdTypeArray> connectivity;
+    wrap(offsets.GetPointer(), vertices->data(), n + 1);
+    wrap(connectivity.GetPointer(), vertices->data(), n);
+    vtkNew<vtkCellArray> cells;
+    cells->SetData(offsets, connectivity);
+
+    vtkNew<vtkSOADataArrayTemplate<Scalar>> positionArray;
+    vtkNew<vtkSOADataArrayTemplate<Scalar>> velocityArray;
+    vtkNew<vtkSOADataArrayTemplate<Scalar>> accelerationArray;
+    vtkNew<DataArray> frictionArray;
+    wrapVector(positionArray.GetPointer(), "Position", points.px, points.py, points.pz, begin, end);
+    wrapVector(velocityArray.GetPointer(), "Velocity", points.vx, points.vy, points.vz, begin, end);
+    wrapVector(accelerationArray.GetPointer(), "Acceleration", points.ax, points.ay, points.az, begin, end);
+    frictionArray->SetName("Friction");
+    wrap(frictionArray.GetPointer(), points.friction.data() + begin, n);
+
+    vtkNew<vtkPoints> vtkPoints;
+    vtkPoints->SetData(positionArray);
 
     vtkNew<vtkPolyData> polyData;
     polyData->SetPoints(vtkPoints);
-    polyData->SetVerts(vertices);
+    polyData->SetVerts(cells);
     polyData->GetPointData()->SetVectors(velocityArray);
     polyData->GetPointData()->AddArray(accelerationArray);
     polyData->GetPointData()->AddArray(frictionArray);
 
-    std::ostringstream oss;
-    oss << filename << "_t" << std::setfill('0') << std::setw(4) << timeStep << ".vtp";
+    // Once points were removed or reordered, keep their original indices.
+    if (points.indexed) {
+        vtkNew<vtkTypeUInt32Array> idArray;
+        idArray->SetName("Id");
+        wrap(idArray.GetPointer(), points.ids.data() + begin, n);
+        polyData->GetPointData()->AddArray(idArray);
+    }
+
+    build.add(0, n);
+    build.stop();
 
+    ProfileScope write(ProfilePhase::VTKWrite, timeStep);
     vtkNew<vtkXMLPolyDataWriter> writer;
-    writer->SetFileName(oss.str().c_str());
+    configure(writer.GetPointer(), options);
+    writer->SetFileName(path.c_str());
     writer->SetInputData(polyData);
     writer->Write();
 
-    std::cout << "VTK output written to: " << oss.str() << std::endl;
+    const std::size_t bytes = fileSize(path);
+    write.add(bytes, n);
+    return bytes;
+}
+
+template std::size_t VTKFrameWriter::write(const ParticleStore&, const std::string&, int);
+template std::size_t VTKFrameWriter::write(const FloatParticleStore&, const std::string&, int);
+
+template <typename Scalar>
+std::size_t VTKWriter::writePoints(const BasicParticleStore<Scalar>& points, const std::string& filename, int timeStep) {
+    VTKFrameWriter writer;
+    return writer.write(points, filename, timeStep);
+}
+
+template std::size_t VTKWriter::writePoints(const ParticleStore&, const std::string&, int);
+template std::size_t VTKWriter::writePoints(const FloatParticleStore&, const std::string&, int);
+
+std::string VTKWriter::frameFilename(const std::string& baseFilename, int timeStep) {
+    std::ostringstream oss;
+    oss << baseFilename << "_t" << std::setfill('0') << std::setw(4) << timeStep << ".vtp";
+    return oss.str();
+}
+
+void VTKWriter::addSinks(Simulator& simulator, const SimulationParams& params) {
+    if (!params.enableVTKOutput || params.vtkOutputFile.empty()) {
+        return;
+    }
+    const VTKOutputOptions options = VTKOutputOptions::fromParams(params);
+    if (params.voxelGrid > 0) {
+        simulator.addOutputSink(std::make_unique<VTKGridSeriesWriter>(params.vtkOutputFile, options));
+        if (simulator.sampleSize() == 0) {
+            return;
+        }
+    }
+    simulator.addOutputSink(std::make_unique<VTKSeriesWriter>(params.vtkOutputFile, options));
+}
+
+void VTKWriter::writeTrajectory(const TrajectoryReader& reader, const std::string& baseFilename) {
+    PVDCollection collection(baseFilename + ".pvd");
+    ParticleStore points;
+    VTKFrameWriter writer;
+
+    for (std::size_t f = 0; f < reader.frameCount(); ++f) {
+        const int timeStep = reader.timeStep(f);
+        reader.readFrame(f, points);
+        writer.write(points, baseFilename, timeStep);
+
+        const std::string path = writer.frameFilename(baseFilename, timeStep);
+        collection.addDataSet(reader.time(f), path);
+        std::cout << "VTK output written to: " << path << std::endl;
+    }
+
+    std::cout << "ParaView collection file written to: " << collection.filename() << std::endl;
+}
+
+VTKSeriesWriter::VTKSeriesWriter(const std::string& baseFilename, const VTKOutputOptions& options)
+    : baseFilename(baseFilename), collection(baseFilename + ".pvd"), writer(options) {
 }
 
-void VTKWriter::writeTimeSeriesPoints(const std::vector<std::vector<Point>>& pointsHistory, const std::string& baseFilename) {
-    for (size_t t = 0; t < pointsHistory.size(); ++t) {
-        writePoints(pointsHistory[t], baseFilename, static_cast<int>(t));
+std::size_t VTKSeriesWriter::process(Frame& frame) {
+    if (frame.precision == Precision::Float) {
+        return writer.write(frame.floatPoints, baseFilename, frame.timeStep);
     }
+    return writer.write(frame.points, baseFilename, frame.timeStep);
+}
+
+std::size_t VTKSeriesWriter::commit(Frame& frame) {
+    ProfileScope profile(ProfilePhase::VTKCollection, frame.timeStep);
+    const std::string path = writer.frameFilename(baseFilename, frame.timeStep);
+    collection.addDataSet(frame.time, path);
+    std::cout << "VTK output written to: " << path << std::endl;
+    return 0;
+}
+
+void VTKSeriesWriter::finish() {
+    std::cout << "ParaView collection file written to: " << collection.filename() << std::endl;
+}
 
-    std::ostringstream pvsm;
-    pvsm << baseFilename << ".pvd";
+VTKGridSeriesWriter::VTKGridSeriesWriter(const std::string& baseFilename, const VTKOutputOptions& options)
+    : baseFilename(baseFilename), options(options), collection(baseFilename + "_grid.pvd") {
+}
 
-    std::ofstream pvdFile(pvsm.str());
-    pvdFile << "<?xml version=\"1.0\"?>\n";
-    pvdFile << "<VTKFile type=\"Collection\" version=\"0.1\">\n";
-    pvdFile << "  <Collection>\n";
+std::string VTKGridSeriesWriter::frameFilename(const std::string& baseFilename, int timeStep) {
+    std::ostringstream oss;
+    oss << baseFilename << "_grid_t" << std::setfill('0') << std::setw(4) << timeStep << ".vti";
+    return oss.str();
+}
 
-    for (size_t t = 0; t < pointsHistory.size(); ++t) {
-        std::ostringstream filename;
-        filename << baseFilename << "_t" << std::setfill('0') << std::setw(4) << t << ".vtp";
-        pvdFile << "    <DataSet timestep=\"" << t << "\" file=\"" << filename.str() << "\"/>\n";
+std::size_t VTKGridSeriesWriter::process(Frame& frame) {
+    const VoxelGrid& grid = frame.grid;
+    if (grid.resolution == 0) {
+        return 0;
     }
+    ProfileScope profile(ProfilePhase::VTKGrid, frame.timeStep);
+    const std::size_t cells = grid.cellCount();
+
+    vtkNew<vtkTypeUInt32Array> countArray;
+    countArray->SetName("Count");
+    wrap(countArray.GetPointer(), grid.count.data(), cells);
+    vtkNew<vtkSOADataArrayTemplate<float>> velocityArray;
+    velocityArray->SetName("Velocity");
+    velocityArray->SetNumberOfComponents(3);
+    velocityArray->SetArray(0, const_cast<float*>(grid.vx.data()), static_cast<vtkIdType>(cells), true, true);
+    velocityArray->SetArray(1, const_cast<float*>(grid.vy.data()), static_cast<vtkIdType>(cells), true, true);
+    velocityArray->SetArray(2, const_cast<float*>(grid.vz.data()), static_cast<vtkIdType>(cells), true, true);
+    vtkNew<vtkFloatArray> frictionArray;
+    frictionArray->SetName("Friction");
+    wrap(frictionArray.GetPointer(), grid.friction.data(), cells);
+
+    // resolution cells per axis take resolution + 1 points.
+    vtkNew<vtkImageData> image;
+    image->SetDimensions(grid.resolution + 1, grid.resolution + 1, grid.resolution + 1);
+    image->SetOrigin(grid.origin, grid.origin, grid.origin);
+    image->SetSpacing(grid.spacing, grid.spacing, grid.spacing);
+    image->GetCellData()->AddArray(countArray);
+    image->GetCellData()->SetVectors(velocityArray);
+    image->GetCellData()->AddArray(frictionArray);
+
+    const std::string path = frameFilename(baseFilename, frame.timeStep);
+    vtkNew<vtkXMLImageDataWriter> writer;
+    configure(writer.GetPointer(), options);
+    writer->SetFileName(path.c_str());
+    writer->SetInputData(image);
+    writer->Write();
+
+    const std::size_t bytes = fileSize(path);
+    profile.add(bytes, cells);
+    return bytes;
+}
 
-    pvdFile << "  </Collection>\n";
-    pvdFile << "</VTKFile>\n";
-    pvdFile.close();
+std::size_t VTKGridSeriesWriter::commit(Frame& frame) {
+    if (frame.grid.resolution == 0) {
+        return 0;
+    }
+    const std::string path = frameFilename(baseFilename, frame.timeStep);
+    collection.addDataSet(frame.time, path);
+    std::cout << "VTK grid written to: " << path << std::endl;
+    return 0;
+}
 
-    std::cout << "ParaView collection file written to: " << pvsm.str() << std::endl;
+void VTKGridSeriesWriter::finish() {
+    std::cout << "ParaView grid collection file written to: " << collection.filename() << std::endl;
 }
@@ -1,10 +1,108 @@
 #pragma once
-#include "Point.h"
-#include <vector>
+#include "ParticleStore.h"
+#include "PVDCollection.h"
+#include "OutputPipeline.h"
+#include "ThreadPool.h"
+#include "VTKOptions.h"
+#include "Simulator.h"
+#include <vtkType.h>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+
+class TrajectoryReader;
+
+// Writes stores as .vtp files without copying them into VTK: position,
+// velocity and acceleration are wrapped as structure-of-arrays VTK arrays
+// (vtkSOADataArrayTemplate) over the store's own component buffers, friction
+// and ids as plain arrays. The vertex cells (one per point) point into one
+// shared 0, 1, 2, ... buffer that serves as both offsets and connectivity,
+// so it is built once and reused by every frame with as many points or
+// fewer. write() may run concurrently for different stores.
+//
+// With more than one piece, frame t is split into contiguous point ranges
+// written concurrently to <filename>_t<t>_p<k>.vtp, and
+// <filename>_t<t>.pvtp lists them for ParaView.
+class VTKFrameWriter {
+public:
+    explicit VTKFrameWriter(const VTKOutputOptions& options = {});
+
+    // Instantiated for ParticleStore and FloatParticleStore; float stores
+    // write Float32 point data. Returns the bytes written.
+    template <typename Scalar>
+    std::size_t write(const BasicParticleStore<Scalar>& points, const std::string& filename, int timeStep);
+
+    // The file that holds frame timeStep: .vtp, or .pvtp with pieces.
+    std::string frameFilename(const std::string& baseFilename, int timeStep) const;
+
+private:
+    template <typename Scalar>
+    std::size_t writePiece(const BasicParticleStore<Scalar>& points, std::size_t begin, std::size_t end,
+                           const std::string& path, int timeStep);
+    // Returns a buffer holding 0 ... count (count + 1 values).
+    std::shared_ptr<const std::vector<vtkIdType>> vertexIds(std::size_t count);
+
+    VTKOutputOptions options;
+    // Writes the pieces of a frame; null with one piece.
+    std::unique_ptr<ThreadPool> pool;
+    std::mutex mutex;
+    std::shared_ptr<const std::vector<vtkIdType>> ids;
+};
 
 class VTKWriter {
 public:
-    static void writePoints(const std::vector<Point>& points, const std::string& filename, int timeStep);
-    static void writeTimeSeriesPoints(const std::vector<std::vector<Point>>& pointsHistory, const std::string& baseFilename);
-};
\ No newline at end of file
+    // Writes <filename>_t<timeStep>.vtp with a one-off VTKFrameWriter;
+    // series should keep one writer instead.
+    template <typename Scalar>
+    static std::size_t writePoints(const BasicParticleStore<Scalar>& points, const std::string& filename, int timeStep);
+    static std::string frameFilename(const std::string& baseFilename, int timeStep);
+    // Converts a native trajectory into the .vtp/.pvd layout written by
+    // VTKSeriesWriter.
+    static void writeTrajectory(const TrajectoryReader& reader, const std::string& baseFilename);
+    // Adds the VTK output params asks for: the point series, or with
+    // voxel_grid the grid series instead, plus the sampled points if
+    // subsample is set too.
+    static void addSinks(Simulator& simulator, const SimulationParams& params);
+};
+
+// Writes a time series as it is produced: every frame goes to disk once and
+// is then listed in <baseFilename>.pvd. Frames may be written concurrently;
+// collection entries are appended in frame order.
+class VTKSeriesWriter : public FrameSink {
+public:
+    explicit VTKSeriesWriter(const std::string& baseFilename, const VTKOutputOptions& options = {});
+
+    const char* name() const override { return "vtk"; }
+    std::size_t process(Frame& frame) override;
+    std::size_t commit(Frame& frame) override;
+    void finish() override;
+
+    const std::string& collectionFilename() const { return collection.filename(); }
+
+private:
+    std::string baseFilename;
+    PVDCollection collection;
+    VTKFrameWriter writer;
+};
+
+// Writes the voxel grid of every frame as <baseFilename>_grid_t<t>.vti: an
+// image whose cells carry Count, Velocity (mean) and Friction (mean),
+// wrapped without copying. Listed in <baseFilename>_grid.pvd.
+class VTKGridSeriesWriter : public FrameSink {
+public:
+    explicit VTKGridSeriesWriter(const std::string& baseFilename, const VTKOutputOptions& options = {});
+
+    const char* name() const override { return "vtk_grid"; }
+    bool wantsGrid() const override { return true; }
+    std::size_t process(Frame& frame) override;
+    std::size_t commit(Frame& frame) override;
+    void finish() override;
+
+    static std::string frameFilename(const std::string& baseFilename, int timeStep);
+
+private:
+    std::string baseFilename;
+    VTKOutputOptions options;
+    PVDCollection collection;
+};
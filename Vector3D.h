@@ -1,41 +1,52 @@
 #pragma once
 #include <cmath>
 
-class Vector3D {
+template <typename Scalar>
+class Vector3 {
 public:
-    double x, y, z;
+    Scalar x, y, z;
     
-    Vector3D() : x(0.0), y(0.0), z(0.0) {}
-    Vector3D(double x, double y, double z) : x(x), y(y), z(z) {}
+    Vector3() : x(0), y(0), z(0) {}
+    Vector3(Scalar x, Scalar y, Scalar z) : x(x), y(y), z(z) {}
+    // Rounds (or widens) every component to Scalar.
+    template <typename Other>
+    explicit Vector3(const Vector3<Other>& other)
+        : x(static_cast<Scalar>(other.x)), y(static_cast<Scalar>(other.y)), z(static_cast<Scalar>(other.z)) {}
     
-    Vector3D operator+(const Vector3D& other) const {
-        return Vector3D(x + other.x, y + other.y, z + other.z);
+    Vector3 operator+(const Vector3& other) const {
+        return Vector3(x + other.x, y + other.y, z + other.z);
     }
     
-    Vector3D operator-(const Vector3D& other) const {
-        return Vector3D(x - other.x, y - other.y, z - other.z);
+    Vector3 operator-(const Vector3& other) const {
+        return Vector3(x - other.x, y - other.y, z - other.z);
     }
     
-    Vector3D operator*(double scalar) const {
-        return Vector3D(x * scalar, y * scalar, z * scalar);
+    Vector3 operator*(Scalar scalar) const {
+        return Vector3(x * scalar, y * scalar, z * scalar);
     }
     
-    Vector3D& operator+=(const Vector3D& other) {
+    Scalar dot(const Vector3& other) const {
+        return x * other.x + y * other.y + z * other.z;
+    }
+    
+    Vector3& operator+=(const Vector3& other) {
         x += other.x;
         y += other.y;
         z += other.z;
         return *this;
     }
     
-    double magnitude() const {
+    Scalar magnitude() const {
         return std::sqrt(x * x + y * y + z * z);
     }
     
-    Vector3D normalized() const {
-        double mag = magnitude();
-        if (mag > 0.0) {
-            return Vector3D(x / mag, y / mag, z / mag);
+    Vector3 normalized() const {
+        Scalar mag = magnitude();
+        if (mag > 0) {
+            return Vector3(x / mag, y / mag, z / mag);
         }
-        return Vector3D();
+        return Vector3();
     }
-};
\ No newline at end of file
+};
+
+using Vector3D = Vector3<double>;
@@ -0,0 +1,88 @@
+#include "VoxelGrid.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+VoxelBinner::VoxelBinner(int resolution, double lower, double upper)
+    : resolution(std::max(resolution, 1)), lower(lower), spacing((upper - lower) / std::max(resolution, 1)),
+      cells(static_cast<std::size_t>(this->resolution) * this->resolution * this->resolution) {
+}
+
+template <typename Scalar>
+void VoxelBinner::bin(const BasicParticleStore<Scalar>& points, ThreadPool& pool, VoxelGrid& grid) {
+    const std::size_t n = points.size();
+    // A private histogram costs a pass over every cell, so there is at most
+    // one per `cells` points.
+    const std::size_t parts = std::max<std::size_t>(1, std::min<std::size_t>(pool.size(), n / cells));
+    if (histograms.size() < parts) {
+        histograms.resize(parts);
+    }
+
+    const double scale = 1.0 / spacing;
+    const long last = resolution;
+    pool.parallelFor(parts, 1, [&](std::size_t first, std::size_t end) {
+        for (std::size_t p = first; p < end; ++p) {
+            Histogram& h = histograms[p];
+            h.count.assign(cells, 0);
+            h.vx.assign(cells, 0.0);
+            h.vy.assign(cells, 0.0);
+            h.vz.assign(cells, 0.0);
+            h.friction.assign(cells, 0.0);
+            h.outside = 0;
+            for (std::size_t i = n * p / parts; i < n * (p + 1) / parts; ++i) {
+                const double x = (points.px[i] - lower) * scale;
+                const double y = (points.py[i] - lower) * scale;
+                const double z = (points.pz[i] - lower) * scale;
+                // Written so that NaN positions also count as outside.
+                if (!(x >= 0.0 && y >= 0.0 && z >= 0.0 && x < last && y < last && z < last)) {
+                    ++h.outside;
+                    continue;
+                }
+                const std::size_t cell = (static_cast<std::size_t>(z) * resolution + static_cast<std::size_t>(y)) * resolution +
+                                         static_cast<std::size_t>(x);
+                ++h.count[cell];
+                h.vx[cell] += points.vx[i];
+                h.vy[cell] += points.vy[i];
+                h.vz[cell] += points.vz[i];
+                h.friction[cell] += points.friction[i];
+            }
+        }
+    });
+
+    grid.resolution = resolution;
+    grid.origin = lower;
+    grid.spacing = spacing;
+    grid.count.resize(cells);
+    grid.vx.resize(cells);
+    grid.vy.resize(cells);
+    grid.vz.resize(cells);
+    grid.friction.resize(cells);
+    grid.outside = 0;
+    for (std::size_t p = 0; p < parts; ++p) {
+        grid.outside += histograms[p].outside;
+    }
+
+    pool.parallelFor(cells, ThreadPool::cacheGrain(4 * sizeof(double) * parts), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            std::uint32_t count = 0;
+            double vx = 0.0, vy = 0.0, vz = 0.0, friction = 0.0;
+            for (std::size_t p = 0; p < parts; ++p) {
+                const Histogram& h = histograms[p];
+                count += h.count[c];
+                vx += h.vx[c];
+                vy += h.vy[c];
+                vz += h.vz[c];
+                friction += h.friction[c];
+            }
+            // Empty cells divide zero sums by one.
+            const double divisor = count > 0 ? count : 1.0;
+            grid.count[c] = count;
+            grid.vx[c] = static_cast<float>(vx / divisor);
+            grid.vy[c] = static_cast<float>(vy / divisor);
+            grid.vz[c] = static_cast<float>(vz / divisor);
+            grid.friction[c] = static_cast<float>(friction / divisor);
+        }
+    });
+}
+
+template void VoxelBinner::bin(const ParticleStore&, ThreadPool&, VoxelGrid&);
+template void VoxelBinner::bin(const FloatParticleStore&, ThreadPool&, VoxelGrid&);
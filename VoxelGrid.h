@@ -0,0 +1,52 @@
+#pragma once
+#include "ParticleStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Point count, mean velocity and mean friction per cell of a resolution^3
+// grid. Cell (i, j, k) is at index (k * resolution + j) * resolution + i,
+// the cell order of vtkImageData; empty cells have zero means. Points
+// outside the grid are only counted in `outside`.
+struct VoxelGrid {
+    int resolution = 0;
+    double origin = 0.0;
+    double spacing = 0.0;
+    std::vector<std::uint32_t> count;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> friction;
+    std::size_t outside = 0;
+
+    std::size_t cellCount() const { return count.size(); }
+};
+
+// Bins stores into a VoxelGrid over [lower, upper)^3. Contiguous ranges of
+// points are binned concurrently into private histograms that are then
+// summed cell by cell, so threads never share a cell. Counts are exact;
+// the means are summed in double and may differ in the last float bit
+// between thread counts.
+class VoxelBinner {
+public:
+    VoxelBinner(int resolution, double lower, double upper);
+
+    // Instantiated for ParticleStore and FloatParticleStore.
+    template <typename Scalar>
+    void bin(const BasicParticleStore<Scalar>& points, ThreadPool& pool, VoxelGrid& grid);
+
+private:
+    struct Histogram {
+        std::vector<std::uint32_t> count;
+        std::vector<double> vx, vy, vz;
+        std::vector<double> friction;
+        std::size_t outside = 0;
+    };
+
+    int resolution;
+    double lower;
+    double spacing;
+    std::size_t cells;
+    // Reused between frames; only as many as the points can fill.
+    std::vector<Histogram> histograms;
+};